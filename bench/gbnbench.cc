@@ -0,0 +1,155 @@
+/*
+ * gbnbench.cc
+ *
+ *  Microbenchmark of the Go Back N protocol core (src/gbn.h) without the simulator.
+ *
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "gbn.h"
+
+/**
+ * A loopback link between a sender and a receiver: the frames of a round are queued and delivered at once,
+ * data frames are corrupted and answers lost with the given probabilities.
+ */
+struct Loopback : public GbnTransport, public GbnRandom
+{
+    std::mt19937 rng{1};
+    std::uniform_real_distribution<double> unit{0.0, 1.0};
+    double corruption = 0; // Probability of a data frame arriving corrupted.
+    std::vector<int> data; // Sequence numbers of the data frames on the way.
+    std::vector<int> control; // ACK numbers on the way, negative (-1 - n) for a NACK of n.
+    long pendingTimers = 0; // Timers started and not fired yet, one per data frame.
+    long framesSent = 0;
+    double now = 0;
+
+    virtual double sendData(long, int seqNum, int) override
+    {
+        data.push_back(seqNum);
+        pendingTimers++;
+        framesSent++;
+        return now;
+    }
+    virtual void sendControl(int ackNum, bool nack, bool lost) override
+    {
+        if(!lost)
+            control.push_back(nack ? -1 - ackNum : ackNum);
+    }
+    virtual double uniform(double a, double b) override { return a + (b - a) * unit(rng); }
+};
+
+struct Scenario
+{
+    const char *name;
+    int windowSize;
+    double corruption; // Probability of a data frame arriving corrupted.
+    double ackLoss; // Probability of an answer being lost, negative for none.
+    bool fastRetransmit;
+    bool adaptive; // An AIMD congestion window of at most windowSize instead of the fixed one.
+};
+
+/**
+ * Sends 'messages' messages through the core and returns the number of data frames it took, retransmissions included.
+ * A round sends what the window allows, delivers it and delivers the answers; a round without progress fires the timers.
+ */
+template<typename SeqNumbers>
+long runFlow(const Scenario& scenario, const SeqNumbers& seqs, long messages, Loopback& link)
+{
+    GbnSender<SeqNumbers> tx;
+    GbnReceiver<SeqNumbers> rx;
+    tx.reset(seqs, scenario.windowSize, messages, scenario.adaptive);
+    rx.reset(seqs, scenario.ackLoss);
+    link.corruption = scenario.corruption;
+    link.framesSent = 0;
+    link.pendingTimers = 0;
+    while(!tx.done()){
+        tx.fillWindow(link);
+        for(int seqNum : link.data)
+            rx.dataReceived(seqNum, link.corruption == 0 || link.unit(link.rng) >= link.corruption, link, link);
+        link.data.clear();
+        long base = tx.next;
+        bool wentBack = false;
+        for(int answer : link.control){
+            if(answer >= 0)
+                tx.ackReceived(answer);
+            else if(scenario.fastRetransmit)
+                wentBack = tx.nackReceived(-1 - answer) || wentBack;
+        }
+        link.control.clear();
+        // Nothing moved: the oldest frame's timer is the one that ends the wait.
+        if(tx.next == base && !wentBack)
+            while(link.pendingTimers > 0){
+                link.pendingTimers--;
+                if(tx.timerFired())
+                    break;
+            }
+        link.now += 1;
+    }
+    return link.framesSent;
+}
+
+// Runs a flow of 'messages' messages again and again for at least minTime seconds, like a Google Benchmark fixture.
+// Overhead is the data frames sent per message (1 without retransmissions), goodput the messages delivered per round.
+template<typename SeqNumbers>
+void benchmark(const char *space, const Scenario& scenario, const SeqNumbers& seqs, long messages, double minTime)
+{
+    Loopback link;
+    long frames = 0, iterations = 0;
+    double rounds = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    do {
+        double firstRound = link.now;
+        frames += runFlow(scenario, seqs, messages, link);
+        rounds += link.now - firstRound;
+        iterations++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while(elapsed < minTime);
+    std::printf("%-10s %-18s %10ld %14.1f %14.3g %10.3f %10.3f\n", space, scenario.name, iterations, 1e9 * elapsed / frames, frames / elapsed,
+            double(frames) / (messages * iterations), messages * iterations / rounds);
+}
+
+int main(int argc, char **argv)
+{
+    double minTime = 1.0;
+    long messages = 1 << 20;
+    for(int i = 1; i < argc; i++){
+        if(std::strncmp(argv[i], "--min-time=", 11) == 0)
+            minTime = std::atof(argv[i] + 11);
+        else if(std::strncmp(argv[i], "--messages=", 11) == 0)
+            messages = std::atol(argv[i] + 11);
+        else {
+            std::fprintf(stderr, "usage: %s [--min-time=seconds] [--messages=per flow]\n", argv[0]);
+            return 1;
+        }
+    }
+    const Scenario scenarios[] = {
+        {"clean/WS8", 8, 0, -1, false, false},
+        {"clean/WS127", 127, 0, -1, false, false},
+        {"lossy/WS8", 8, 0.01, 0.01, false, false},
+        {"lossy/WS8/fr", 8, 0.01, 0.01, true, false},
+        // Fixed against adaptive windows as the corruption and the ACK loss grow.
+        {"clean/WS64", 64, 0, -1, false, false},
+        {"clean/WS64/aimd", 64, 0, -1, false, true},
+        {"lossy/WS64", 64, 0.01, 0.01, false, false},
+        {"lossy/WS64/aimd", 64, 0.01, 0.01, false, true},
+        {"lossy/WS64/fr", 64, 0.01, 0.01, true, false},
+        {"lossy/WS64/fr/aimd", 64, 0.01, 0.01, true, true},
+        {"ber10/WS64", 64, 0.1, -1, false, false},
+        {"ber10/WS64/aimd", 64, 0.1, -1, false, true},
+        {"lp10/WS64", 64, 0, 0.1, false, false},
+        {"lp10/WS64/aimd", 64, 0, 0.1, false, true},
+        {"lossy30/WS64", 64, 0.3, 0.3, true, false},
+        {"lossy30/WS64/aimd", 64, 0.3, 0.3, true, true},
+    };
+    std::printf("%-10s %-18s %10s %14s %14s %10s %10s\n", "space", "scenario", "iterations", "ns/frame", "frames/s", "overhead", "goodput");
+    for(const Scenario& scenario : scenarios){
+        benchmark("SeqSpace", scenario, SeqSpace(8, scenario.windowSize), messages, minTime);
+        benchmark("Fixed<8>", scenario, FixedSeqSpace<8>(8, scenario.windowSize), messages, minTime);
+    }
+    return 0;
+}
@@ -178,6 +178,8 @@ void MessageFrame_Base::copy(const MessageFrame_Base& other)
     this->parity = other.parity;
     this->frameType = other.frameType;
     this->ackNum = other.ackNum;
+    this->flowId = other.flowId;
+    this->moreFragments = other.moreFragments;
 }
 
 void MessageFrame_Base::parsimPack(omnetpp::cCommBuffer *b) const
@@ -188,6 +190,8 @@ void MessageFrame_Base::parsimPack(omnetpp::cCommBuffer *b) const
     doParsimPacking(b,this->parity);
     doParsimPacking(b,this->frameType);
     doParsimPacking(b,this->ackNum);
+    doParsimPacking(b,this->flowId);
+    doParsimPacking(b,this->moreFragments);
 }
 
 void MessageFrame_Base::parsimUnpack(omnetpp::cCommBuffer *b)
@@ -198,6 +202,8 @@ void MessageFrame_Base::parsimUnpack(omnetpp::cCommBuffer *b)
     doParsimUnpacking(b,this->parity);
     doParsimUnpacking(b,this->frameType);
     doParsimUnpacking(b,this->ackNum);
+    doParsimUnpacking(b,this->flowId);
+    doParsimUnpacking(b,this->moreFragments);
 }
 
 int MessageFrame_Base::getSeqNum() const
@@ -250,6 +256,26 @@ void MessageFrame_Base::setAckNum(int ackNum)
     this->ackNum = ackNum;
 }
 
+int MessageFrame_Base::getFlowId() const
+{
+    return this->flowId;
+}
+
+void MessageFrame_Base::setFlowId(int flowId)
+{
+    this->flowId = flowId;
+}
+
+bool MessageFrame_Base::getMoreFragments() const
+{
+    return this->moreFragments;
+}
+
+void MessageFrame_Base::setMoreFragments(bool moreFragments)
+{
+    this->moreFragments = moreFragments;
+}
+
 class MessageFrameDescriptor : public omnetpp::cClassDescriptor
 {
   private:
@@ -260,6 +286,8 @@ class MessageFrameDescriptor : public omnetpp::cClassDescriptor
         FIELD_parity,
         FIELD_frameType,
         FIELD_ackNum,
+        FIELD_flowId,
+        FIELD_moreFragments,
     };
   public:
     MessageFrameDescriptor();
@@ -327,7 +355,7 @@ const char *MessageFrameDescriptor::getProperty(const char *propertyName) const
 int MessageFrameDescriptor::getFieldCount() const
 {
     omnetpp::cClassDescriptor *base = getBaseClassDescriptor();
-    return base ? 5+base->getFieldCount() : 5;
+    return base ? 7+base->getFieldCount() : 7;
 }
 
 unsigned int MessageFrameDescriptor::getFieldTypeFlags(int field) const
@@ -344,8 +372,10 @@ unsigned int MessageFrameDescriptor::getFieldTypeFlags(int field) const
         FD_ISEDITABLE,    // FIELD_parity
         FD_ISEDITABLE,    // FIELD_frameType
         FD_ISEDITABLE,    // FIELD_ackNum
+        FD_ISEDITABLE,    // FIELD_flowId
+        FD_ISEDITABLE,    // FIELD_moreFragments
     };
-    return (field >= 0 && field < 5) ? fieldTypeFlags[field] : 0;
+    return (field >= 0 && field < 7) ? fieldTypeFlags[field] : 0;
 }
 
 const char *MessageFrameDescriptor::getFieldName(int field) const
@@ -362,8 +392,10 @@ const char *MessageFrameDescriptor::getFieldName(int field) const
         "parity",
         "frameType",
         "ackNum",
+        "flowId",
+        "moreFragments",
     };
-    return (field >= 0 && field < 5) ? fieldNames[field] : nullptr;
+    return (field >= 0 && field < 7) ? fieldNames[field] : nullptr;
 }
 
 int MessageFrameDescriptor::findField(const char *fieldName) const
@@ -375,6 +407,8 @@ int MessageFrameDescriptor::findField(const char *fieldName) const
     if (strcmp(fieldName, "parity") == 0) return baseIndex + 2;
     if (strcmp(fieldName, "frameType") == 0) return baseIndex + 3;
     if (strcmp(fieldName, "ackNum") == 0) return baseIndex + 4;
+    if (strcmp(fieldName, "flowId") == 0) return baseIndex + 5;
+    if (strcmp(fieldName, "moreFragments") == 0) return baseIndex + 6;
     return base ? base->findField(fieldName) : -1;
 }
 
@@ -392,8 +426,10 @@ const char *MessageFrameDescriptor::getFieldTypeString(int field) const
         "char",    // FIELD_parity
         "int",    // FIELD_frameType
         "int",    // FIELD_ackNum
+        "int",    // FIELD_flowId
+        "bool",    // FIELD_moreFragments
     };
-    return (field >= 0 && field < 5) ? fieldTypeStrings[field] : nullptr;
+    return (field >= 0 && field < 7) ? fieldTypeStrings[field] : nullptr;
 }
 
 const char **MessageFrameDescriptor::getFieldPropertyNames(int field) const
@@ -481,6 +517,8 @@ std::string MessageFrameDescriptor::getFieldValueAsString(omnetpp::any_ptr objec
         case FIELD_parity: return long2string(pp->getParity());
         case FIELD_frameType: return long2string(pp->getFrameType());
         case FIELD_ackNum: return long2string(pp->getAckNum());
+        case FIELD_flowId: return long2string(pp->getFlowId());
+        case FIELD_moreFragments: return bool2string(pp->getMoreFragments());
         default: return "";
     }
 }
@@ -502,6 +540,8 @@ void MessageFrameDescriptor::setFieldValueAsString(omnetpp::any_ptr object, int
         case FIELD_parity: pp->setParity(string2long(value)); break;
         case FIELD_frameType: pp->setFrameType(string2long(value)); break;
         case FIELD_ackNum: pp->setAckNum(string2long(value)); break;
+        case FIELD_flowId: pp->setFlowId(string2long(value)); break;
+        case FIELD_moreFragments: pp->setMoreFragments(string2bool(value)); break;
         default: throw omnetpp::cRuntimeError("Cannot set field %d of class 'MessageFrame_Base'", field);
     }
 }
@@ -521,6 +561,8 @@ omnetpp::cValue MessageFrameDescriptor::getFieldValue(omnetpp::any_ptr object, i
         case FIELD_parity: return pp->getParity();
         case FIELD_frameType: return pp->getFrameType();
         case FIELD_ackNum: return pp->getAckNum();
+        case FIELD_flowId: return pp->getFlowId();
+        case FIELD_moreFragments: return pp->getMoreFragments();
         default: throw omnetpp::cRuntimeError("Cannot return field %d of class 'MessageFrame_Base' as cValue -- field index out of range?", field);
     }
 }
@@ -542,6 +584,8 @@ void MessageFrameDescriptor::setFieldValue(omnetpp::any_ptr object, int field, i
         case FIELD_parity: pp->setParity(omnetpp::checked_int_cast<char>(value.intValue())); break;
         case FIELD_frameType: pp->setFrameType(omnetpp::checked_int_cast<int>(value.intValue())); break;
         case FIELD_ackNum: pp->setAckNum(omnetpp::checked_int_cast<int>(value.intValue())); break;
+        case FIELD_flowId: pp->setFlowId(omnetpp::checked_int_cast<int>(value.intValue())); break;
+        case FIELD_moreFragments: pp->setMoreFragments(value.boolValue()); break;
         default: throw omnetpp::cRuntimeError("Cannot set field %d of class 'MessageFrame_Base'", field);
     }
 }
@@ -39,6 +39,8 @@ class MessageFrame;
  *     //	bits parity;
  *     int frameType;
  *     int ackNum;
+ *     int flowId; // The ARQ flow (coordinator session) the frame belongs to.
+ *     bool moreFragments; // The payload is a fragment of a longer line and more fragments follow.
  * }
  * </pre>
  *
@@ -74,6 +76,8 @@ class MessageFrame_Base : public ::omnetpp::cPacket
     char parity = 0;
     int frameType = 0; //Data=0, ACK=1, NACK=2.
     int ackNum = 0;
+    int flowId = 0;
+    bool moreFragments = false;
 
   private:
     void copy(const MessageFrame_Base& other);
@@ -108,6 +112,12 @@ class MessageFrame_Base : public ::omnetpp::cPacket
 
     virtual int getAckNum() const;
     virtual void setAckNum(int ackNum);
+
+    virtual int getFlowId() const;
+    virtual void setFlowId(int flowId);
+
+    virtual bool getMoreFragments() const;
+    virtual void setMoreFragments(bool moreFragments);
 };
 
 
@@ -0,0 +1,226 @@
+/*
+ * calendarqueue.cc
+ *
+ *  A calendar queue future event set.
+ *
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+/**
+ * A calendar queue (R. Brown, 1988) future event set, selected with futureeventset-class = "CalendarQueue" in the ini file.
+ * Simulated time is cut into days of equal width and the events of day d go to bucket d modulo the number of buckets,
+ * so the first event is found by walking the buckets from the current day on; with the width near the mean gap
+ * between the events every bucket holds a few of them, and insertion and removal take constant time on average.
+ * The number of buckets doubles when there are more than two events per bucket and halves below half an event per
+ * bucket, and every resize sets the width again from the gaps between the first events.
+ * Each bucket is a cEventHeap of its own: the heap keeps the events of a day in OMNeT++'s order (time, priority, then
+ * insertion), and through it the events know they are scheduled, so cancelEvent() and isScheduled() work as with
+ * the default event heap. Events of the same time always share a bucket, so their insertion order stays comparable.
+ * get() goes through the buckets in turn, and sort() sorts the events within each bucket.
+ */
+class CalendarQueue : public cFutureEventSet
+{
+  public:
+    explicit CalendarQueue(const char *name = nullptr);
+    CalendarQueue(const CalendarQueue&) = delete;
+    CalendarQueue& operator=(const CalendarQueue&) = delete;
+    virtual ~CalendarQueue();
+    virtual std::string str() const override;
+    virtual void forEachChild(cVisitor *v) override;
+    virtual void insert(cEvent *event) override;
+    virtual cEvent *peekFirst() const override;
+    virtual cEvent *removeFirst() override;
+    virtual void putBackFirst(cEvent *event) override;
+    virtual cEvent *remove(cEvent *event) override;
+    virtual bool isEmpty() const override { return length == 0; }
+    virtual void clear() override;
+    virtual int getLength() const override { return length; }
+    virtual cEvent *get(int k) override;
+    virtual void sort() override;
+
+  protected:
+    static constexpr int minBuckets = 2;
+    static constexpr int widthSamples = 25; // Used to set the width from the gaps between this many first events.
+    std::vector<cEventHeap *> buckets;
+    double width = 1; // Used to keep the length of a day in seconds.
+    mutable int64_t currentDay = 0; // Used to keep the day the search for the first event starts from, none is earlier.
+    int length = 0;
+    int64_t dayOf(const cEvent *event) const { return int64_t(std::floor(event->getArrivalTime().dbl() / width)); }
+    cEventHeap *bucketOf(int64_t day) const { return buckets[day % int64_t(buckets.size())]; }
+    // Used to find the bucket of the first event, moving the current day to it.
+    cEventHeap *firstBucket() const;
+    // Used to spread the events over a new number of buckets, with the width set from the events.
+    void resize(int bucketCount);
+};
+
+Register_Class(CalendarQueue);
+
+CalendarQueue::CalendarQueue(const char *name) : cFutureEventSet(name)
+{
+    for(int i=0; i<minBuckets; i++){
+        buckets.push_back(new cEventHeap("bucket"));
+        take(buckets.back());
+    }
+}
+
+CalendarQueue::~CalendarQueue()
+{
+    for(cEventHeap *bucket : buckets)
+        dropAndDelete(bucket);
+}
+
+std::string CalendarQueue::str() const
+{
+    if(length == 0)
+        return "empty";
+    return "length=" + std::to_string(length) + ", " + std::to_string(buckets.size()) + " buckets of " + std::to_string(width) + "s";
+}
+
+void CalendarQueue::forEachChild(cVisitor *v)
+{
+    for(cEventHeap *bucket : buckets)
+        bucket->forEachChild(v);
+}
+
+void CalendarQueue::insert(cEvent *event)
+{
+    int64_t day = dayOf(event);
+    bucketOf(day)->insert(event);
+    length++;
+    if(day < currentDay)
+        currentDay = day;
+    if(length > 2 * int(buckets.size()))
+        resize(2 * buckets.size());
+}
+
+cEventHeap *CalendarQueue::firstBucket() const
+{
+    if(length == 0)
+        return nullptr;
+    // An event due today is the first one; an event of a later day in the bucket belongs to a later lap of the calendar.
+    int64_t day = currentDay;
+    for(size_t i=0; i<buckets.size(); i++, day++){
+        cEventHeap *bucket = bucketOf(day);
+        if(!bucket->isEmpty() && dayOf(bucket->peekFirst()) == day){
+            currentDay = day;
+            return bucket;
+        }
+    }
+    // A whole lap without an event: the first one is further ahead, look at the first event of every bucket.
+    cEventHeap *first = nullptr;
+    for(cEventHeap *bucket : buckets)
+        if(!bucket->isEmpty() && (!first || bucket->peekFirst()->getArrivalTime() < first->peekFirst()->getArrivalTime()))
+            first = bucket;
+    currentDay = dayOf(first->peekFirst());
+    return first;
+}
+
+cEvent *CalendarQueue::peekFirst() const
+{
+    cEventHeap *bucket = firstBucket();
+    return bucket ? bucket->peekFirst() : nullptr;
+}
+
+cEvent *CalendarQueue::removeFirst()
+{
+    cEventHeap *bucket = firstBucket();
+    if(!bucket)
+        return nullptr;
+    cEvent *event = bucket->removeFirst();
+    length--;
+    if(int(buckets.size()) > minBuckets && length < int(buckets.size()) / 2)
+        resize(buckets.size() / 2);
+    return event;
+}
+
+void CalendarQueue::putBackFirst(cEvent *event)
+{
+    int64_t day = dayOf(event);
+    bucketOf(day)->putBackFirst(event);
+    length++;
+    if(day < currentDay)
+        currentDay = day;
+}
+
+cEvent *CalendarQueue::remove(cEvent *event)
+{
+    if(!event->isScheduled())
+        return nullptr;
+    cEvent *removed = bucketOf(dayOf(event))->remove(event);
+    if(removed)
+        length--;
+    return removed;
+}
+
+void CalendarQueue::clear()
+{
+    for(cEventHeap *bucket : buckets)
+        bucket->clear();
+    length = 0;
+    currentDay = 0;
+}
+
+cEvent *CalendarQueue::get(int k)
+{
+    if(k < 0)
+        return nullptr;
+    for(cEventHeap *bucket : buckets){
+        if(k < bucket->getLength())
+            return bucket->get(k);
+        k -= bucket->getLength();
+    }
+    return nullptr;
+}
+
+void CalendarQueue::sort()
+{
+    for(cEventHeap *bucket : buckets)
+        bucket->sort();
+}
+
+void CalendarQueue::resize(int bucketCount)
+{
+    // Take the events out in order, so the events of the same time go back in the order they were inserted.
+    std::vector<cEvent *> events;
+    events.reserve(length);
+    while(cEventHeap *bucket = firstBucket()){
+        events.push_back(bucket->removeFirst());
+        length--;
+    }
+    // The width is three times the mean gap between the first events, leaving out the gaps over twice the mean (Brown).
+    int samples = std::min(int(events.size()), widthSamples);
+    if(samples > 1){
+        double total = (events[samples - 1]->getArrivalTime() - events[0]->getArrivalTime()).dbl();
+        double mean = total / (samples - 1), kept = 0;
+        int keptGaps = 0;
+        for(int i=1; i<samples; i++){
+            double gap = (events[i]->getArrivalTime() - events[i - 1]->getArrivalTime()).dbl();
+            if(gap <= 2 * mean){
+                kept += gap;
+                keptGaps++;
+            }
+        }
+        // Events all at the same time tell nothing about the gaps, the width stays.
+        if(kept > 0)
+            width = 3 * kept / keptGaps;
+    }
+    while(int(buckets.size()) < bucketCount){
+        buckets.push_back(new cEventHeap("bucket"));
+        take(buckets.back());
+    }
+    while(int(buckets.size()) > bucketCount){
+        dropAndDelete(buckets.back());
+        buckets.pop_back();
+    }
+    for(cEvent *event : events)
+        bucketOf(dayOf(event))->insert(event);
+    length = events.size();
+    currentDay = events.empty() ? 0 : dayOf(events.front());
+}
@@ -0,0 +1,68 @@
+/*
+ * checkpoint.h
+ *
+ *  Saving and restoring the state of a running session.
+ *
+ */
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <string>
+#include <iostream>
+#include <omnetpp.h>
+#include "MessageFrame_m.h"
+
+/**
+ * Interface of the modules whose state can be written to a checkpoint and loaded back into a fresh run.
+ * The Coordinator takes the checkpoint: it saves the state of every module, the RNG positions and the pending events,
+ * and on restore it loads the state back and hands every pending event to the module that has to reschedule or resend it.
+ */
+class Checkpointable
+{
+  public:
+    virtual ~Checkpointable() {}
+    virtual void saveState(std::ostream& os) = 0; // Used to write the protocol state.
+    virtual void loadState(std::istream& is) = 0; // Used to read back what saveState() wrote.
+    // Used to reschedule a pending self message, or to resend a frame that was on its way to the other node.
+    virtual void restoreEvent(MessageFrame_Base *msg, omnetpp::simtime_t arrivalTime, bool selfMessage) = 0;
+};
+
+/// Checkpoint File Helper Functions
+// Strings are written with their length first since payloads and log lines may hold spaces and newlines.
+inline void writeCheckpointString(std::ostream& os, const std::string& s)
+{
+    os << s.size() << ':' << s;
+}
+
+inline std::string readCheckpointString(std::istream& is)
+{
+    size_t size = 0;
+    char colon = 0;
+    is >> size >> colon;
+    std::string s(size, '\0');
+    is.read(&s[0], size);
+    if(!is || colon != ':')
+        throw omnetpp::cRuntimeError("Corrupted checkpoint file");
+    return s;
+}
+
+// Reads a key checking that it is the expected one.
+inline void readCheckpointKey(std::istream& is, const char *key)
+{
+    std::string k;
+    is >> k;
+    if(!is || k != key)
+        throw omnetpp::cRuntimeError("Corrupted checkpoint file: expected '%s', got '%s'", key, k.c_str());
+}
+
+// Reads a "key value" line.
+template<typename T> T readCheckpointValue(std::istream& is, const char *key)
+{
+    readCheckpointKey(is, key);
+    T value;
+    if(!(is >> value))
+        throw omnetpp::cRuntimeError("Corrupted checkpoint file: bad value of '%s'", key);
+    return value;
+}
+
+#endif /* CHECKPOINT_H_ */
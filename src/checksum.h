@@ -0,0 +1,60 @@
+/*
+ * checksum.h
+ *
+ *  Trailers the data frames are checked with.
+ *
+ */
+#ifndef CHECKSUM_H_
+#define CHECKSUM_H_
+
+#include <string>
+
+/**
+ * The original trailer: the even parity of every bit position, i.e. the XOR of all the payload bytes.
+ * It misses any even number of errors in the same bit position.
+ */
+struct ParityChecksum
+{
+    static unsigned char compute(const std::string& payload)
+    {
+        unsigned char parity = 0;
+        for(char c : payload)
+            parity ^= static_cast<unsigned char>(c);
+        return parity;
+    }
+};
+
+/**
+ * The CRC-8 of every byte value for the polynomial x^8 + x^2 + x + 1 (0x07), built at compile time.
+ */
+struct Crc8Table
+{
+    unsigned char crc[256];
+    constexpr Crc8Table() : crc()
+    {
+        for(int byte = 0; byte < 256; byte++){
+            unsigned char c = byte;
+            for(int i = 0; i < 8; i++)
+                c = (c & 0x80) ? (c << 1) ^ 0x07 : c << 1;
+            crc[byte] = c;
+        }
+    }
+};
+inline constexpr Crc8Table crc8Table;
+
+/**
+ * CRC-8 (polynomial 0x07) computed a byte at a time from the table.
+ * It catches every burst of up to 8 bits and every odd number of errors, unlike the parity.
+ */
+struct Crc8Checksum
+{
+    static unsigned char compute(const std::string& payload)
+    {
+        unsigned char crc = 0;
+        for(char c : payload)
+            crc = crc8Table.crc[crc ^ static_cast<unsigned char>(c)];
+        return crc;
+    }
+};
+
+#endif /* CHECKSUM_H_ */
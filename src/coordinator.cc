@@ -8,55 +8,172 @@
 #include <string>
 #include <omnetpp.h>
 #include <fstream>
-#include "MessageFrame_m.h"
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <chrono>
+#include "messageframe.h"
+#include "checkpoint.h"
+#include "memstats.h"
+#include "tracewriter.h"
+#include "frametrain.h"
+#include "counters.h"
+#include "steadystate.h"
 
 using namespace omnetpp;
 
+/**
+ * One transfer of the schedule in coordinator.txt: the sending node, the receiving node, its starting time and the file it sends.
+ */
+struct Session
+{
+    int src;
+    int dst;
+    double start;
+    std::string inputFile;
+};
+
 /**
  * Derive the Coordinator class from cSimpleModule. The Coordinator mainly reads the coordinator.txt to start the network.
- * It reads the starting node and the starting time. It sends a message to the starting node with the starting time given in the message.
- * It sends a message "No" to the other node to let it know that it's a receiver.
+ * Every line of coordinator.txt is a session, either Session=[src,dst,start,file] or the original Node_id=[src,start]
+ * which sends input<src>.txt to the other node of the first pair. Each session is launched by a self message at its starting time:
+ * the coordinator sends the sending node a message named after its input file, and a message "No" to the receiving node to let it know that it's a receiver.
+ * Every session is a flow of its own with the session index as its flow id, so sessions between the same nodes share their link.
+ * It also takes the checkpoint of the session at checkpointAt (the nodes' state, the RNG positions and all the pending events)
+ * and, instead of starting the nodes, restores such a checkpoint into a fresh run when asked to.
+ * Every fesSampleInterval it records the size of the future event set and how many of its events are data frames,
+ * control frames, timers, deferred log lines, link events and others, to show where the scheduling effort goes.
+ * At the end it reports the memory the run used (peak live frames, in all and of every frame kind, input file bytes, queued
+ * trace bytes and resident set size), and with a memoryBudget it aborts the run going over it.
+ * With the async or gzip traceWriter it opens the background trace writer for the run and closes it at the end.
+ * Every dashboardInterval it sums the nodes' counters into the goodput, window occupancy and retransmission ratio of the
+ * interval, records them and shows them with the events per second on the dashboard figures of the Network in a GUI.
  */
 class Coordinator : public cSimpleModule
 {
   protected:
     // The following redefined virtual function holds the algorithm.
-    char chosen;
-    double startingTime;
-    virtual void initialize() override;
+    std::vector<Session> sessions; // Used to hold the schedule read from coordinator.txt.
+    std::vector<cMessage *> launchMsgs; // Used to launch every session at its starting time, the kind is the session index.
+    cMessage *checkpointMsg = nullptr; // Used to take the checkpoint after all the other events of its time.
+    cMessage *fesSampleMsg = nullptr; // Used to sample the future event set every fesSampleInterval.
+    enum EventKind { DATA, CONTROL, TIMER, LOG, LINK, OTHER, EVENT_KINDS };
+    cOutVector fesLengthVector; // Used to record the number of events in the future event set.
+    cOutVector fesKindVectors[EVENT_KINDS]; // Used to record the number of events of every kind in it.
+    cStdDev fesLengthStats; // Used to summarize the samples in the scalars.
+    cMessage *memoryCheckMsg = nullptr; // Used to check the memory budget every memoryCheckInterval.
+    cMessage *dashboardMsg = nullptr; // Used to update the dashboard every dashboardInterval.
+    cOutVector goodputVector, occupancyVector, retransmissionVector; // Used to record what the dashboard shows.
+    ProtocolCounters lastCounters; // Used to compute the dashboard over the last interval.
+    long lastEvents = 0; // Used with lastRefresh to compute the events per second of the figures.
+    std::chrono::steady_clock::time_point lastRefresh; // Used to refresh the figures at most 10 times a second of wall time.
+    virtual int numInitStages() const override { return 2; } // The checkpoint is restored once the nodes are initialized.
+    virtual void initialize(int stage) override;
     virtual void handleMessage(cMessage *msg) override;
-    char readInputFile(const char *filename);
+    virtual void finish() override;
+    void readInputFile(const char *filename);
+    void scheduleLaunches(simtime_t after); // Used to schedule the launch of the sessions starting after 'after'.
+    void launch(int flowId); // Used to start the two nodes of a session, the session index is the id of its flow.
+    EventKind getEventKind(cEvent *event);
+    static const char *getEventKindName(int kind); // Used to name the vectors and scalars of every kind.
+    int sampleFes(); // Used to record the size and the event kinds of the future event set, returns the size.
+    void checkMemoryBudget(); // Used to abort the run once its peak resident set size is over memoryBudget.
+    void updateDashboard(); // Used to record the dashboard of the last interval and show it on the figures.
+    bool sessionRunning(); // Used to stop the periodic messages once only they are left.
+    /// Node Helper Functions
+    // Nodes 0 and 1 are node0 and node1, node k >= 2 is node[k-2] of the extra pairs.
+    cModule *getNode(int id);
+    cGate *getNodePort(int id); // Used to get the gate to the node.
+    std::vector<cModule *> getNodes();
+    /// Checkpoint Helper Functions
+    void writeCheckpoint(const char *filename); // Used to save the session at the current time.
+    simtime_t restoreCheckpoint(const char *filename); // Used to load a saved session into this run, returns the time it was taken at.
+  public:
+    virtual ~Coordinator();
 };
 
 // The module class needs to be registered with OMNeT++
 Define_Module(Coordinator);
 
-void Coordinator::initialize()
-{
-    std::ifstream OpenFile;
-    char sender = '0';
-    char receiver = '1';
-    char content = readInputFile("coordinator.txt");
-    MessageFrame_Base *senderMsg = new MessageFrame_Base(std::to_string(startingTime).c_str());
-    MessageFrame_Base *receiverMsg = new MessageFrame_Base("No");
-    std::string string1 = "port0$o";
-    std::string string2 = "port1$o";
-    if(content == '0'){
-        send(senderMsg, string1.c_str());
-        send(receiverMsg, string2.c_str());
-    } else{
-        send(senderMsg, string2.c_str());
-        send(receiverMsg, string1.c_str());
+Coordinator::~Coordinator()
+{
+    cancelAndDelete(checkpointMsg);
+    cancelAndDelete(fesSampleMsg);
+    cancelAndDelete(memoryCheckMsg);
+    cancelAndDelete(dashboardMsg);
+    for(cMessage *msg : launchMsgs)
+        cancelAndDelete(msg);
+}
+
+void Coordinator::initialize(int stage)
+{
+    bool restore = getParentModule()->par("restoreCheckpoint");
+    if(stage == 1){
+        simtime_t start = 0;
+        if(restore)
+            start = restoreCheckpoint(getParentModule()->par("checkpointFile").stdstringValue().c_str());
+        double fesSampleInterval = getParentModule()->par("fesSampleInterval");
+        if(fesSampleInterval > 0){
+            fesLengthVector.setName("fesLength");
+            for(int k=0; k<EVENT_KINDS; k++)
+                fesKindVectors[k].setName((std::string("fes:") + getEventKindName(k)).c_str());
+            fesSampleMsg = new cMessage("fesSample");
+            scheduleAt(start, fesSampleMsg);
+        }
+        if(double(getParentModule()->par("memoryBudget")) > 0){
+            memoryCheckMsg = new cMessage("memoryCheck");
+            scheduleAt(start, memoryCheckMsg);
+        }
+        double dashboardInterval = getParentModule()->par("dashboardInterval");
+        if(dashboardInterval > 0){
+            goodputVector.setName("goodput");
+            occupancyVector.setName("windowOccupancy");
+            retransmissionVector.setName("retransmissionRatio");
+            lastEvents = getSimulation()->getEventNumber();
+            lastRefresh = std::chrono::steady_clock::now();
+            dashboardMsg = new cMessage("dashboard");
+            scheduleAt(start + dashboardInterval, dashboardMsg);
+        }
+        return;
     }
+    memoryAccount.resetPeaks();
+    double checkpointAt = getParentModule()->par("checkpointAt");
+    if(checkpointAt > 0 && !restore){
+        checkpointMsg = new cMessage("checkpoint");
+        checkpointMsg->setSchedulingPriority(SHRT_MAX);
+        scheduleAt(checkpointAt, checkpointMsg);
+    }
+    readInputFile("coordinator.txt");
+    // Every node receiving a session of the schedule is an estimator from the start, so the run also waits for the receivers launched later.
+    std::vector<int> receivers;
+    if(double(getParentModule()->par("steadyStatePrecision")) > 0)
+        for(const Session& s : sessions)
+            if(std::find(receivers.begin(), receivers.end(), s.dst) == receivers.end())
+                receivers.push_back(s.dst);
+    steadyStateEstimators = receivers.size();
+    std::string writer = getParentModule()->par("traceWriter").stdstringValue();
+    if(writer != "direct" && writer != "async" && writer != "gzip")
+        throw cRuntimeError("Unknown trace writer '%s', use direct, async or gzip", writer.c_str());
+    // A checkpoint keeps the size of output.txt to cut the trace back to on restore, which needs it written as it goes.
+    if(writer != "direct" && (checkpointAt > 0 || restore))
+        throw cRuntimeError("Checkpoints need the direct trace writer (traceWriter = \"direct\")");
+    if(restore)
+        return; // The sessions that had not started yet are scheduled once the checkpoint is restored.
+    scheduleLaunches(-1);
     std::ofstream filestream;
     filestream.open("output.txt", std::ofstream::out);
     if(!filestream)
         throw cRuntimeError("Error opening file '%s'?", "output.txt");
     else
         filestream.close();
+    // The nodes write their trace lines through the background writer once it's open.
+    if(writer != "direct" && bool(getParentModule()->par("writeTrace")))
+        traceWriter.open(writer == "gzip" ? "output.txt.gz" : "output.txt", writer == "gzip");
 }
 
-char Coordinator::readInputFile(const char *filename)
+void Coordinator::readInputFile(const char *filename)
 {
     std::ifstream filestream;
     std::string line;
@@ -65,24 +182,347 @@ char Coordinator::readInputFile(const char *filename)
 
     if(!filestream) {
         throw cRuntimeError("Error opening file '%s'?", filename);
-        return -1;
     } else {
         while ( getline(filestream, line) ) {
-//                EV<<line;
-            if (line.find(',')) {
-                int beg = line.find(',');
-                chosen = line[beg-1];
-                startingTime = std::stod(line.substr(beg+1, line.size()-beg-2));
-//                EV<<chosen;
-                return chosen;
-
+            size_t beg = line.find('[');
+            size_t end = line.find(']');
+            if(beg == std::string::npos || end == std::string::npos || end < beg)
+                continue;
+            std::vector<std::string> fields;
+            std::stringstream entries(line.substr(beg+1, end-beg-1));
+            std::string field;
+            while(getline(entries, field, ','))
+                fields.push_back(field);
+            Session session;
+            try {
+                if(line.compare(0, beg, "Node_id=") == 0 && fields.size() == 2) {
+                    session.src = std::stoi(fields[0]);
+                    session.dst = session.src == 0 ? 1 : 0;
+                    session.start = std::stod(fields[1]);
+                    session.inputFile = "input"+fields[0]+".txt";
+                } else if(line.compare(0, beg, "Session=") == 0 && fields.size() == 4) {
+                    session.src = std::stoi(fields[0]);
+                    session.dst = std::stoi(fields[1]);
+                    session.start = std::stod(fields[2]);
+                    session.inputFile = fields[3];
+                } else
+                    throw std::invalid_argument(line);
+            } catch(const std::logic_error&) {
+                throw cRuntimeError("Bad line '%s' in '%s', use Session=[src,dst,start,file] or Node_id=[src,start]", line.c_str(), filename);
             }
+            sessions.push_back(session);
         }
     }
-    return '_';
+    // Check the schedule against the topology. Sessions between the same nodes are separate flows on their link.
+    for(const Session& s : sessions){
+        if(!getNode(s.src) || !getNode(s.dst) || s.src == s.dst || s.start < 0)
+            throw cRuntimeError("Bad session from Node[%d] to Node[%d] at time %g in '%s'", s.src, s.dst, s.start, filename);
+        // Without a channel module in between the sending node must be linked to the receiving one.
+        cModule *peer = getNode(s.src)->gate("nodeGate$o")->getPathEndGate()->getOwnerModule();
+        if(peer->hasGate("nodeCoord") && peer != getNode(s.dst))
+            throw cRuntimeError("Node[%d] has no link to Node[%d]", s.src, s.dst);
+    }
+    if(sessions.empty())
+        throw cRuntimeError("No session in '%s'", filename);
+}
+
+void Coordinator::scheduleLaunches(simtime_t after)
+{
+    launchMsgs.assign(sessions.size(), nullptr);
+    for(size_t i=0; i<sessions.size(); i++){
+        if(sessions[i].start <= after)
+            continue;
+        launchMsgs[i] = new cMessage("launch", i);
+        scheduleAt(sessions[i].start, launchMsgs[i]);
+    }
+}
+
+void Coordinator::launch(int flowId)
+{
+    const Session& session = sessions[flowId];
+    MessageFrame_Base *senderMsg = new MessageFrame(session.inputFile.c_str());
+    senderMsg->setPayload(std::to_string(session.start - simTime().dbl())); // The time to wait before sending.
+    senderMsg->setFlowId(flowId);
+    MessageFrame_Base *receiverMsg = new MessageFrame("No");
+    receiverMsg->setFlowId(flowId);
+    send(senderMsg, getNodePort(session.src));
+    send(receiverMsg, getNodePort(session.dst));
+    EV<<"Session from Node["<<session.src<<"] to Node["<<session.dst<<"] with '"<<session.inputFile<<"' started at time ["<<simTime()<<"]\n";
 }
 
 void Coordinator::handleMessage(cMessage *msg)
 {
+    if(msg == checkpointMsg) {
+        writeCheckpoint(getParentModule()->par("checkpointFile").stdstringValue().c_str());
+        return;
+    }
+    if(msg == fesSampleMsg) {
+        sampleFes();
+        // Stop sampling once the session is over, so the run still ends when there are no more events.
+        if(sessionRunning())
+            scheduleAt(simTime() + getParentModule()->par("fesSampleInterval").doubleValue(), fesSampleMsg);
+        return;
+    }
+    if(msg == memoryCheckMsg) {
+        checkMemoryBudget();
+        // Like the sampling, the checks stop with the session.
+        if(sessionRunning())
+            scheduleAt(simTime() + getParentModule()->par("memoryCheckInterval").doubleValue(), memoryCheckMsg);
+        return;
+    }
+    if(msg == dashboardMsg) {
+        updateDashboard();
+        if(sessionRunning())
+            scheduleAt(simTime() + getParentModule()->par("dashboardInterval").doubleValue(), dashboardMsg);
+        return;
+    }
+    launchMsgs[msg->getKind()] = nullptr;
+    launch(msg->getKind());
+    delete msg;
+}
 
+Coordinator::EventKind Coordinator::getEventKind(cEvent *event)
+{
+    if(dynamic_cast<FrameTrain *>(event))
+        return DATA;
+    MessageFrame_Base *frame = dynamic_cast<MessageFrame_Base *>(event);
+    // The coordinator's own messages and the ones it sends to start the nodes.
+    if(!frame || frame->getArrivalModule() == this || frame->getSenderModule() == this)
+        return OTHER;
+    if(frame->getFrameType() == -1)
+        return LOG;
+    if(frame->isSelfMessage() && strcmp(frame->getName(), "linkFree") == 0)
+        return LINK;
+    if(frame->isSelfMessage() && strcmp(frame->getName(), "Timeout") == 0)
+        return TIMER;
+    return frame->getFrameType() == 0 ? DATA : CONTROL;
+}
+
+const char *Coordinator::getEventKindName(int kind)
+{
+    static const char *names[EVENT_KINDS] = {"data", "control", "timer", "log", "link", "other"};
+    return names[kind];
+}
+
+int Coordinator::sampleFes()
+{
+    cFutureEventSet *fes = getSimulation()->getFES();
+    int counts[EVENT_KINDS] = {};
+    int length = fes->getLength(); // The sampling message itself is out of it while it is handled.
+    for(int i=0; i<length; i++)
+        counts[getEventKind(fes->get(i))]++;
+    fesLengthVector.record(length);
+    fesLengthStats.collect(length);
+    for(int k=0; k<EVENT_KINDS; k++)
+        fesKindVectors[k].record(counts[k]);
+    return length;
+}
+
+bool Coordinator::sessionRunning()
+{
+    // The periodic messages waiting don't count, or they would keep each other going for ever.
+    int periodic = 0;
+    for(cMessage *msg : {fesSampleMsg, memoryCheckMsg, dashboardMsg})
+        if(msg && msg->isScheduled())
+            periodic++;
+    return getSimulation()->getFES()->getLength() > periodic;
+}
+
+void Coordinator::checkMemoryBudget()
+{
+    double budget = getParentModule()->par("memoryBudget");
+    long long rss = peakResidentBytes();
+    if(rss > budget * 1024 * 1024)
+        throw cRuntimeError("The run went over its memory budget: %.1f MiB resident (budget %g MiB), %ld live frames "
+                "(%ld data, %ld control, %ld timer, %ld log), %ld input bytes, %ld deferred trace bytes",
+                rss / (1024.0 * 1024.0), budget, memoryAccount.frames, memoryAccount.kindFrames[DATA_FRAME],
+                memoryAccount.kindFrames[CONTROL_FRAME], memoryAccount.kindFrames[TIMER_FRAME], memoryAccount.kindFrames[LOG_FRAME],
+                memoryAccount.inputBytes, memoryAccount.traceBytes);
+}
+
+void Coordinator::updateDashboard()
+{
+    ProtocolCounters counters;
+    for(cModule *node : getNodes())
+        check_and_cast<Counted *>(node)->addCounters(counters);
+    double goodput = 8 * (counters.deliveredBytes - lastCounters.deliveredBytes) / getParentModule()->par("dashboardInterval").doubleValue();
+    double occupancy = counters.windowLimit > 0 ? double(counters.inFlight) / counters.windowLimit : 0;
+    long sent = counters.sentFrames - lastCounters.sentFrames;
+    double retransmissions = sent > 0 ? double(counters.retransmittedFrames - lastCounters.retransmittedFrames) / sent : 0;
+    lastCounters = counters;
+    goodputVector.record(goodput);
+    occupancyVector.record(occupancy);
+    retransmissionVector.record(retransmissions);
+    // Only a GUI draws the figures, and it doesn't redraw them more often than that however fast the run goes.
+    auto now = std::chrono::steady_clock::now();
+    double wallTime = std::chrono::duration<double>(now - lastRefresh).count();
+    if(!getEnvir()->isGUI() || wallTime < 0.1)
+        return;
+    double eventRate = (getSimulation()->getEventNumber() - lastEvents) / wallTime;
+    lastEvents = getSimulation()->getEventNumber();
+    lastRefresh = now;
+    cFigure *dashboard = getParentModule()->getCanvas()->getFigure("dashboard");
+    if(!dashboard)
+        return;
+    dashboard->setVisible(true);
+    char text[64];
+    snprintf(text, sizeof(text), "goodput %.0f bps", goodput);
+    check_and_cast<cTextFigure *>(dashboard->getFigure("goodput"))->setText(text);
+    snprintf(text, sizeof(text), "window %ld/%ld", counters.inFlight, counters.windowLimit);
+    check_and_cast<cTextFigure *>(dashboard->getFigure("window"))->setText(text);
+    cFigure::Rectangle track = check_and_cast<cRectangleFigure *>(dashboard->getFigure("windowTrack"))->getBounds();
+    track.width *= occupancy;
+    check_and_cast<cRectangleFigure *>(dashboard->getFigure("windowBar"))->setBounds(track);
+    snprintf(text, sizeof(text), "retransmitted %.1f%%", 100 * retransmissions);
+    check_and_cast<cTextFigure *>(dashboard->getFigure("retransmissions"))->setText(text);
+    snprintf(text, sizeof(text), "%.3g events/s", eventRate);
+    check_and_cast<cTextFigure *>(dashboard->getFigure("events"))->setText(text);
+}
+
+void Coordinator::finish()
+{
+    traceWriter.close(); // Everything the nodes wrote is on disk when the run is over.
+    if(fesSampleMsg && fesLengthStats.getCount() > 0){
+        recordScalar("fesMeanLength", fesLengthStats.getMean());
+        recordScalar("fesMaxLength", fesLengthStats.getMax());
+    }
+    recordScalar("peakFrames", memoryAccount.peakFrames);
+    for(int k=0; k<FRAME_KINDS; k++)
+        recordScalar((std::string("peakFrames:") + MemoryAccount::frameKindName(k)).c_str(), memoryAccount.peakKindFrames[k]);
+    recordScalar("peakQueuedTraceBytes", memoryAccount.peakTraceBytes, "B");
+    recordScalar("peakInputBytes", memoryAccount.peakInputBytes, "B");
+    recordScalar("peakResidentBytes", peakResidentBytes(), "B"); // Of the whole process, so of the earlier runs too.
+}
+
+cModule *Coordinator::getNode(int id)
+{
+    if(id == 0 || id == 1)
+        return getParentModule()->getSubmodule(id == 0 ? "node0" : "node1");
+    return id > 1 ? getParentModule()->getSubmodule("node", id - 2) : nullptr;
+}
+
+cGate *Coordinator::getNodePort(int id)
+{
+    if(id == 0 || id == 1)
+        return gate(id == 0 ? "port0$o" : "port1$o");
+    return gate("nodePort$o", id - 2);
+}
+
+std::vector<cModule *> Coordinator::getNodes()
+{
+    std::vector<cModule *> nodes;
+    for(int id=0; getNode(id); id++)
+        nodes.push_back(getNode(id));
+    return nodes;
+}
+
+void Coordinator::writeCheckpoint(const char *filename)
+{
+    // Frames in a datarate link or in the channel module can't be put back where they were.
+    if(double(getParentModule()->par("linkDatarate")) > 0 || bool(getParentModule()->par("useChannel")))
+        throw cRuntimeError("Checkpoints need the fixed delay model (linkDatarate = 0 and useChannel = false)");
+    std::ofstream os(filename);
+    if(!os)
+        throw cRuntimeError("Error opening file '%s'?", filename);
+    os << "time " << simTime().raw() << "\nsessions " << sessions.size() << "\n";
+    std::ifstream trace("output.txt", std::ios_base::binary | std::ios_base::ate);
+    os << "output " << (trace ? (long long)trace.tellg() : 0) << "\n";
+    std::vector<cModule *> nodes = getNodes();
+    os << "nodes " << nodes.size() << "\n";
+    for(cModule *node : nodes){
+        os << "node " << node->getFullName() << "\nrng " << node->getRNG(0)->getNumbersDrawn() << "\n";
+        check_and_cast<Checkpointable *>(node)->saveState(os);
+    }
+    // Save the pending events in the order they would be processed, so ties are restored in the same order.
+    std::vector<MessageFrame_Base *> events;
+    cFutureEventSet *fes = getSimulation()->getFES();
+    for(int i=0; i<fes->getLength(); i++){
+        cMessage *msg = dynamic_cast<cMessage *>(fes->get(i));
+        // The sessions still to launch are scheduled again from coordinator.txt on restore.
+        if(msg && msg != checkpointMsg && msg->getArrivalModule() != this)
+            events.push_back(check_and_cast<MessageFrame_Base *>(msg));
+    }
+    std::sort(events.begin(), events.end(), [](MessageFrame_Base *a, MessageFrame_Base *b){
+        if(a->getArrivalTime() != b->getArrivalTime())
+            return a->getArrivalTime() < b->getArrivalTime();
+        if(a->getSchedulingPriority() != b->getSchedulingPriority())
+            return a->getSchedulingPriority() < b->getSchedulingPriority();
+        // Not the id: the nodes reuse the messages of their trace lines, so only the insertion order follows the scheduling.
+        return a->getInsertOrder() < b->getInsertOrder();
+    });
+    os << "events " << events.size() << "\n";
+    for(MessageFrame_Base *f : events){
+        // Self messages go back to their module, frames on the way are resent by the node that sent them.
+        bool self = f->isSelfMessage();
+        cModule *owner = self ? f->getArrivalModule() : f->getSenderModule();
+        os << owner->getFullName() << " " << self << " " << f->getArrivalTime().raw() << " " << f->getSchedulingPriority() << " " << f->getKind() << " ";
+        os << f->getFlowId() << " " << f->getFrameType() << " " << f->getSeqNum() << " " << f->getAckNum() << " " << int(f->getParity()) << " " << f->hasBitError() << " " << f->getByteLength() << " " << f->getMoreFragments() << " ";
+        writeCheckpointString(os, f->getName());
+        os << " ";
+        writeCheckpointString(os, f->getPayload());
+        os << "\n";
+    }
+    EV<<"Checkpoint taken at time ["<<simTime()<<"] in '"<<filename<<"'\n";
+}
+
+simtime_t Coordinator::restoreCheckpoint(const char *filename)
+{
+    std::ifstream is(filename);
+    if(!is)
+        throw cRuntimeError("Error opening file '%s'?", filename);
+    simtime_t time = SimTime::fromRaw(readCheckpointValue<int64_t>(is, "time"));
+    if(readCheckpointValue<size_t>(is, "sessions") != sessions.size())
+        throw cRuntimeError("The checkpoint '%s' was taken with a different coordinator.txt", filename);
+    // Keep the trace up to the checkpoint so the rest of the run continues it.
+    long long outputSize = readCheckpointValue<long long>(is, "output");
+    std::string trace(outputSize, '\0');
+    std::ifstream in("output.txt", std::ios_base::binary);
+    if(!in.read(&trace[0], outputSize))
+        throw cRuntimeError("'output.txt' is shorter than when the checkpoint '%s' was taken", filename);
+    in.close();
+    std::ofstream out("output.txt", std::ios_base::binary | std::ios_base::trunc);
+    out.write(trace.data(), trace.size());
+    out.close();
+    int nodeCount = readCheckpointValue<int>(is, "nodes");
+    for(int i=0; i<nodeCount; i++){
+        std::string name = readCheckpointValue<std::string>(is, "node");
+        cModule *node = getParentModule()->getModuleByPath(("."+name).c_str());
+        if(!node)
+            throw cRuntimeError("The checkpoint '%s' has an unknown node '%s'", filename, name.c_str());
+        unsigned long drawn = readCheckpointValue<unsigned long>(is, "rng");
+        check_and_cast<Checkpointable *>(node)->loadState(is);
+        // Bring the random number stream to where it was.
+        cRNG *rng = node->getRNG(0);
+        while(rng->getNumbersDrawn() < drawn)
+            rng->intRand();
+    }
+    int count = readCheckpointValue<int>(is, "events");
+    for(int i=0; i<count; i++){
+        std::string owner;
+        bool self, bitError, moreFragments;
+        int64_t arrival;
+        int priority, kind, flowId, frameType, seqNum, ackNum, parity;
+        long long byteLength;
+        is >> owner >> self >> arrival >> priority >> kind >> flowId >> frameType >> seqNum >> ackNum >> parity >> bitError >> byteLength >> moreFragments;
+        std::string name = readCheckpointString(is);
+        std::string payload = readCheckpointString(is);
+        cModule *node = getParentModule()->getModuleByPath(("."+owner).c_str());
+        if(!is || !node)
+            throw cRuntimeError("Corrupted checkpoint file '%s'", filename);
+        MessageFrame_Base *f = new MessageFrame(name.c_str(), kind);
+        f->setPayload(payload);
+        f->setFlowId(flowId);
+        f->setFrameType(frameType);
+        f->setSeqNum(seqNum);
+        f->setAckNum(ackNum);
+        f->setParity(char(parity));
+        f->setBitError(bitError);
+        f->setByteLength(byteLength);
+        f->setMoreFragments(moreFragments);
+        f->setSchedulingPriority(priority);
+        check_and_cast<Checkpointable *>(node)->restoreEvent(f, SimTime::fromRaw(arrival), self);
+    }
+    scheduleLaunches(time);
+    EV<<"Restored the checkpoint taken at time ["<<time<<"] from '"<<filename<<"'\n";
+    return time;
 }
@@ -0,0 +1,62 @@
+/*
+ * counterrandom.h
+ *
+ *  Counter-based random numbers, every draw a function of what it is drawn for.
+ *
+ */
+#ifndef COUNTERRANDOM_H_
+#define COUNTERRANDOM_H_
+
+#include <cstdint>
+
+// What a counter-based draw is for, part of its counter.
+enum RandomPurpose : uint32_t
+{
+    ACK_LOSS_DRAW = 1, // Whether the answer to a data frame is lost.
+    ERROR_BYTE_DRAW = 2, // The byte of a modified frame that gets a bit flipped.
+    ERROR_BIT_DRAW = 3 // The bit of that byte.
+};
+
+/**
+ * Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC 2011): ten rounds that scramble a 128-bit
+ * counter under a 64-bit key. A draw keeps no state, its counter is the flow, the sequence number, the purpose and the number
+ * of the draw within the flow, so it doesn't depend on the draws before it, of this flow or of any other: a frame gets the
+ * same errors however many flows run next to it and in whatever order their events are run. The key is the run's seed-set.
+ */
+class CounterRandom
+{
+  public:
+    explicit CounterRandom(uint64_t key = 0) : key(key) {}
+    void setKey(uint64_t k) { key = k; }
+    // Used to draw uniformly from [a, b).
+    double uniform(double a, double b, uint32_t flow, uint32_t seqNum, uint32_t purpose, uint32_t draw) const
+    {
+        uint32_t block[4] = {flow, seqNum, purpose, draw};
+        philox(block);
+        // The top 53 bits of the first two words make a double in [0, 1).
+        uint64_t bits = (uint64_t(block[0]) << 32 | block[1]) >> 11;
+        return a + (b - a) * (bits * (1.0 / 9007199254740992.0));
+    }
+    // Used to encrypt the counter in place.
+    void philox(uint32_t block[4]) const
+    {
+        uint32_t k0 = uint32_t(key), k1 = uint32_t(key >> 32);
+        for(int round = 0; round < 10; round++){
+            uint64_t p0 = uint64_t(0xD2511F53) * block[0];
+            uint64_t p1 = uint64_t(0xCD9E8D57) * block[2];
+            uint32_t c1 = block[1], c3 = block[3];
+            block[0] = uint32_t(p1 >> 32) ^ c1 ^ k0;
+            block[1] = uint32_t(p1);
+            block[2] = uint32_t(p0 >> 32) ^ c3 ^ k1;
+            block[3] = uint32_t(p0);
+            // The Weyl sequence of the round keys.
+            k0 += 0x9E3779B9;
+            k1 += 0xBB67AE85;
+        }
+    }
+
+  private:
+    uint64_t key;
+};
+
+#endif /* COUNTERRANDOM_H_ */
@@ -0,0 +1,32 @@
+/*
+ * counters.h
+ *
+ *  What the nodes count while running, for the dashboard of the Coordinator.
+ *
+ */
+#ifndef COUNTERS_H_
+#define COUNTERS_H_
+
+/**
+ * The running totals of the flows of one or more nodes.
+ */
+struct ProtocolCounters
+{
+    long deliveredBytes = 0; // Bytes of the lines the receivers delivered.
+    long sentFrames = 0; // Data frames the senders sent, retransmissions included.
+    long retransmittedFrames = 0; // The ones of them that were dropped by a timeout or a NACK and sent again.
+    long inFlight = 0; // Frames in the windows of the senders still sending.
+    long windowLimit = 0; // Frames those windows may hold: WS, or the congestion window of an adaptive sender.
+};
+
+/**
+ * Interface of the modules that add their counters to the dashboard. The Coordinator sums them over all the nodes.
+ */
+class Counted
+{
+  public:
+    virtual ~Counted() {}
+    virtual void addCounters(ProtocolCounters& counters) const = 0;
+};
+
+#endif /* COUNTERS_H_ */
@@ -0,0 +1,164 @@
+/*
+ * frameimage.cc
+ *
+ *  Writing and mapping the binary input format.
+ *
+ */
+#include "frameimage.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::string stuffFrame(const std::string& message)
+{
+    std::string s(1, FRAME_FLAG);
+    for(char c : message){
+        if(c == FRAME_FLAG || c == FRAME_ESCAPE)
+            s += FRAME_ESCAPE;
+        s += c;
+    }
+    s += FRAME_FLAG;
+    return s;
+}
+
+size_t fragmentEnd(const std::string& message, size_t start, long mtu)
+{
+    size_t end = start;
+    long frameSize = FRAME_OVERHEAD + 2; // The header and the two flags.
+    while(end < message.size()){
+        int charSize = (message[end] == FRAME_FLAG || message[end] == FRAME_ESCAPE) ? 2 : 1;
+        if(mtu > 0 && frameSize + charSize > mtu)
+            break;
+        frameSize += charSize;
+        end++;
+    }
+    return end;
+}
+
+bool FrameImage::isImage(const char *filename)
+{
+    std::ifstream filestream(filename, std::ios::binary);
+    char magic[4] = {};
+    return filestream.read(magic, 4) && std::memcmp(magic, "GBNF", 4) == 0;
+}
+
+void FrameImage::write(const char *filename, const std::vector<std::string>& errors, const std::vector<std::string>& messages,
+        const std::vector<bool>& moreFragments, long mtu, size_t lines)
+{
+    size_t count = messages.size();
+    Header header = {};
+    std::memcpy(header.magic, "GBNF", 4);
+    header.version = version;
+    header.byteOrder = byteOrderMark;
+    header.mtu = mtu;
+    header.count = count;
+    header.lines = lines;
+    header.entriesOffset = sizeof(Header);
+    header.errorsOffset = header.entriesOffset + count * sizeof(Entry);
+    header.dataOffset = header.errorsOffset + (count + 1) / 2;
+    std::vector<Entry> entries(count);
+    std::vector<unsigned char> codes((count + 1) / 2);
+    std::string data;
+    for(size_t j = 0; j < count; j++){
+        std::string payload = stuffFrame(messages[j]);
+        Entry& entry = entries[j];
+        entry.message = data.size();
+        entry.messageLength = messages[j].size();
+        data += messages[j];
+        entry.payload = data.size();
+        entry.payloadLength = payload.size();
+        data += payload;
+        entry.moreFragments = moreFragments[j];
+        entry.parity = ParityChecksum::compute(payload);
+        entry.crc8 = Crc8Checksum::compute(payload);
+        int nibble = 0;
+        for(int bit = 0; bit < 4; bit++)
+            if(errors[j][bit] == '1')
+                nibble |= 8 >> bit;
+        codes[j / 2] |= nibble << (j % 2 * 4);
+    }
+    if(data.size() > UINT32_MAX)
+        throw std::runtime_error(std::string("Too much input for an image in '") + filename + "'");
+    header.size = header.dataOffset + data.size();
+    std::ofstream filestream(filename, std::ios::binary | std::ios::trunc);
+    filestream.write((const char *)&header, sizeof(header));
+    filestream.write((const char *)entries.data(), count * sizeof(Entry));
+    filestream.write((const char *)codes.data(), codes.size());
+    filestream.write(data.data(), data.size());
+    if(!filestream)
+        throw std::runtime_error(std::string("Error writing file '") + filename + "'?");
+}
+
+FrameImage::FrameImage(const char *filename)
+{
+#ifdef _WIN32
+    std::ifstream filestream(filename, std::ios::binary);
+    if(!filestream)
+        throw std::runtime_error(std::string("Error opening file '") + filename + "'?");
+    contents.assign(std::istreambuf_iterator<char>(filestream), std::istreambuf_iterator<char>());
+    image = contents.data();
+    length = contents.size();
+#else
+    int fd = open(filename, O_RDONLY);
+    struct stat status;
+    if(fd < 0 || fstat(fd, &status) != 0){
+        if(fd >= 0)
+            close(fd);
+        throw std::runtime_error(std::string("Error opening file '") + filename + "'?");
+    }
+    length = status.st_size;
+    void *mapping = length > 0 ? mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd); // The mapping keeps the file.
+    if(mapping == MAP_FAILED)
+        throw std::runtime_error(std::string("Error mapping file '") + filename + "'?");
+    image = (const char *)mapping;
+#endif
+    header = (const Header *)image;
+    const char *problem = nullptr;
+    if(length < sizeof(Header) || std::memcmp(header->magic, "GBNF", 4) != 0)
+        problem = "is not a frame image";
+    else if(header->byteOrder != byteOrderMark)
+        problem = "was written on a host of the other byte order";
+    else if(header->version != version)
+        problem = "has an unknown version";
+    else if(header->size != length || header->entriesOffset + header->count * sizeof(Entry) > header->errorsOffset
+            || header->errorsOffset + (header->count + 1) / 2 > header->dataOffset || header->dataOffset > length)
+        problem = "is truncated or corrupted";
+    if(problem){
+        std::string message = std::string("The file '") + filename + "' " + problem;
+        unmap();
+        throw std::runtime_error(message);
+    }
+    entries = (const Entry *)(image + header->entriesOffset);
+    errors = (const unsigned char *)(image + header->errorsOffset);
+    data = image + header->dataOffset;
+    size_t dataSize = length - header->dataOffset;
+    for(size_t j = 0; j < count(); j++)
+        if(size_t(entries[j].message) + entries[j].messageLength > dataSize || size_t(entries[j].payload) + entries[j].payloadLength > dataSize){
+            std::string message = std::string("The file '") + filename + "' is truncated or corrupted";
+            unmap();
+            throw std::runtime_error(message);
+        }
+}
+
+FrameImage::~FrameImage()
+{
+    unmap();
+}
+
+void FrameImage::unmap()
+{
+#ifndef _WIN32
+    if(image)
+        munmap((void *)image, length);
+#endif
+    image = nullptr;
+}
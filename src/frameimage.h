@@ -0,0 +1,109 @@
+/*
+ * frameimage.h
+ *
+ *  The binary input format: the frames of an input file ready to send, to be mapped into memory.
+ *
+ */
+#ifndef FRAMEIMAGE_H_
+#define FRAMEIMAGE_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "checksum.h"
+
+// Bytes a frame carries besides its payload: sequence/ACK number, frame type and the parity trailer.
+#define FRAME_OVERHEAD 3
+#define FRAME_FLAG '$'
+#define FRAME_ESCAPE '/'
+
+// Byte stuffing of a message into a frame payload: the flags around it and an escape before every flag or escape in it.
+std::string stuffFrame(const std::string& message);
+// Used to split a line into fragments that fit frames of mtu bytes (0 for no limit): returns the end of the fragment from 'start'.
+size_t fragmentEnd(const std::string& message, size_t start, long mtu);
+
+/**
+ * An input file converted (see tools/gbnimage) to the frames the sender sends: per frame its message, its byte-stuffed
+ * payload with the parity and CRC-8 trailers, whether more fragments follow and its 4-bit error code. The lines are
+ * fragmented for the mtu given to the converter, which the run has to use too.
+ *
+ * Layout, in the byte order of the host that wrote it and contiguous so the file is used as mapped:
+ *   Header       magic "GBNF", version, byte order mark, mtu, frame and line counts, offsets of the sections, file size
+ *   Entry[count] per frame: offset and length of the message and of the payload in the data section, the flags and trailers
+ *   errors       the error codes, a nibble per frame (the first frame in the low nibble), bit 3 for modification to bit 0 for delay
+ *   data         the messages and payloads
+ * Opening an image maps it read-only, so the senders of several flows of the same file share its pages. Bad files throw std::runtime_error.
+ */
+class FrameImage
+{
+  public:
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t mtu;
+        uint32_t count; // Frames.
+        uint32_t lines; // Lines of the text input they come from.
+        uint64_t entriesOffset;
+        uint64_t errorsOffset;
+        uint64_t dataOffset;
+        uint64_t size;
+    };
+    struct Entry
+    {
+        uint32_t message;
+        uint32_t messageLength;
+        uint32_t payload;
+        uint32_t payloadLength;
+        uint8_t moreFragments;
+        uint8_t parity;
+        uint8_t crc8;
+        uint8_t reserved;
+    };
+    static constexpr uint32_t version = 1;
+    static constexpr uint32_t byteOrderMark = 0x01020304;
+
+    explicit FrameImage(const char *filename);
+    ~FrameImage();
+    FrameImage(const FrameImage&) = delete;
+    FrameImage& operator=(const FrameImage&) = delete;
+    // Whether the file starts like an image, so it's opened as one instead of read as text.
+    static bool isImage(const char *filename);
+    // Used by the converter to write the frames of a text input file.
+    static void write(const char *filename, const std::vector<std::string>& errors, const std::vector<std::string>& messages,
+            const std::vector<bool>& moreFragments, long mtu, size_t lines);
+
+    size_t count() const { return header->count; }
+    long mtu() const { return header->mtu; }
+    size_t size() const { return length; }
+    std::string_view message(size_t j) const { return std::string_view(data + entries[j].message, entries[j].messageLength); }
+    std::string_view payload(size_t j) const { return std::string_view(data + entries[j].payload, entries[j].payloadLength); }
+    bool moreFragments(size_t j) const { return entries[j].moreFragments; }
+    unsigned char trailer(size_t j, const ParityChecksum&) const { return entries[j].parity; }
+    unsigned char trailer(size_t j, const Crc8Checksum&) const { return entries[j].crc8; }
+    std::string errorCode(size_t j) const
+    {
+        int nibble = (errors[j / 2] >> (j % 2 * 4)) & 0xf;
+        std::string code = "0000";
+        for(int bit = 0; bit < 4; bit++)
+            if(nibble & (8 >> bit))
+                code[bit] = '1';
+        return code;
+    }
+
+  private:
+    void unmap();
+    const char *image = nullptr;
+    size_t length = 0;
+    const Header *header = nullptr;
+    const Entry *entries = nullptr;
+    const unsigned char *errors = nullptr;
+    const char *data = nullptr;
+#ifdef _WIN32
+    std::vector<char> contents; // No mapping on Windows, the file is read into memory.
+#endif
+};
+
+#endif /* FRAMEIMAGE_H_ */
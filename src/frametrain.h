@@ -0,0 +1,58 @@
+/*
+ * frametrain.h
+ *
+ *  The data frames of a window sent as one message.
+ *
+ */
+#ifndef FRAMETRAIN_H_
+#define FRAMETRAIN_H_
+
+#include <algorithm>
+#include <vector>
+#include <utility>
+#include <omnetpp.h>
+#include "MessageFrame_m.h"
+
+#define WINDOW_TRAIN 3 // The kind of a FrameTrain, next to the kinds of the link model's self messages.
+
+/**
+ * The data frames a sender sends for a window (duplicates included) in one message, each with the time it arrives at,
+ * in arrival order (frames arriving at the same time in the order they were sent). The train arrives with its first frame;
+ * the receiving node takes the frames off one at a time and schedules the train again for the next one, so a window
+ * is a single event in the future event set instead of one per frame.
+ */
+class FrameTrain : public omnetpp::cMessage
+{
+  public:
+    explicit FrameTrain(const char *name = "train") : cMessage(name, WINDOW_TRAIN) {}
+    virtual ~FrameTrain()
+    {
+        for(size_t i = next; i < frames.size(); i++)
+            dropAndDelete(frames[i].second);
+    }
+    // A train is handed from node to node as it is, never copied.
+    virtual FrameTrain *dup() const override { throw omnetpp::cRuntimeError("A FrameTrain can't be duplicated"); }
+    void add(omnetpp::simtime_t arrival, MessageFrame_Base *frame)
+    {
+        take(frame);
+        auto at = std::upper_bound(frames.begin() + next, frames.end(), arrival, [](omnetpp::simtime_t t, const Entry& e) { return t < e.first; });
+        frames.insert(at, Entry(arrival, frame));
+    }
+    bool empty() const { return next == frames.size(); }
+    size_t size() const { return frames.size() - next; }
+    omnetpp::simtime_t nextArrival() const { return frames[next].first; }
+    // Used to take the next frame off, the caller owns it.
+    MessageFrame_Base *pop()
+    {
+        MessageFrame_Base *frame = frames[next++].second;
+        drop(frame);
+        return frame;
+    }
+
+  private:
+    typedef std::pair<omnetpp::simtime_t, MessageFrame_Base *> Entry;
+    std::vector<Entry> frames;
+    size_t next = 0; // The frames before it were taken off already.
+};
+
+#endif /* FRAMETRAIN_H_ */
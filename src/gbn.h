@@ -0,0 +1,200 @@
+/*
+ * gbn.h
+ *
+ *  The Go Back N protocol logic, independent of the simulator.
+ *
+ */
+#ifndef GBN_H_
+#define GBN_H_
+
+#include <algorithm>
+#include <stdexcept>
+#include "seqnum.h"
+#include "window.h"
+
+/// Environment Interfaces
+// What the protocol needs from where it runs. The Node adapts them to OMNeT++, the benchmark (bench/) to plain loops.
+// There is no clock of its own: the transport tells when every frame leaves, which is all the window keeps of time.
+class GbnRandom
+{
+  public:
+    virtual ~GbnRandom() {}
+    virtual double uniform(double a, double b) = 0;
+};
+
+class GbnTransport
+{
+  public:
+    virtual ~GbnTransport() {}
+    // Used to send the frame of message 'index' as the position-th frame of the window, returns the time it leaves the sender.
+    virtual double sendData(long index, int seqNum, int position) = 0;
+    // Used to answer a data frame with an ACK or a NACK carrying ackNum; a lost answer is reported but never arrives.
+    virtual void sendControl(int ackNum, bool nack, bool lost) = 0;
+};
+
+/**
+ * The sender side of a Go Back N flow: the window over the messages to send, its sequence numbers and its timers.
+ * Timers are never cancelled. Every timer still running when its frame is acknowledged or dropped for a retransmission
+ * is counted in stoppedTimeouts and skipped when it fires, so only the timer of the oldest frame in flight can time out.
+ * ACKs are cumulative: an ACK for any frame after the window base acknowledges every frame before it, so the window
+ * slides over all of them and a lost ACK is made up for by any later one.
+ * An adaptive sender sends at most a congestion window of frames (AIMD): it starts at one frame, grows by one frame per
+ * window of acknowledged frames, is halved whenever the sender goes back (a timeout or a fast retransmit NACK)
+ * and never exceeds windowSize. A fixed sender always fills windowSize.
+ */
+template<typename SeqNumbers>
+struct GbnSender
+{
+    SeqNumbers seqs; // The sequence-number space.
+    int windowSize = 1;
+    long messageCount = 0; // Number of messages to send.
+    long next = 0; // Index of the oldest message not acknowledged yet (the window base).
+    int seqBeg = 0; // Sequence number of the window base.
+    int stoppedTimeouts = 0; // Timers that were stopped and still have to fire.
+    long lastNack = -1; // Window base that was already gone back to on a NACK, so a repeated NACK is ignored.
+    bool adaptive = false; // Whether the congestion window limits the frames in flight.
+    double congestionWindow = 1; // Frames the adaptive sender may have in flight, its integer part counts.
+    InFlightWindow window; // The frames sent and not acknowledged yet.
+
+    void reset(const SeqNumbers& seqNumbers, int size, long count, bool adaptiveWindow = false)
+    {
+        seqs = seqNumbers;
+        windowSize = size;
+        messageCount = count;
+        next = 0;
+        seqBeg = 0;
+        stoppedTimeouts = 0;
+        lastNack = -1;
+        adaptive = adaptiveWindow;
+        congestionWindow = adaptive ? 1 : size;
+        window.reset(size);
+    }
+    bool done() const { return next >= messageCount; }
+    // The frames the sender may have in flight now.
+    int sendWindow() const { return adaptive ? int(congestionWindow) : windowSize; }
+    // Used when the sender goes back: the multiplicative decrease.
+    void decreaseWindow()
+    {
+        if(adaptive)
+            congestionWindow = std::max(1.0, congestionWindow / 2);
+    }
+    // Used when a timer fires. Returns whether it is a timeout, the window is then dropped to be sent again.
+    bool timerFired()
+    {
+        if(done())
+            return false;
+        if(stoppedTimeouts > 0){
+            stoppedTimeouts--;
+            return false;
+        }
+        stoppedTimeouts += window.size() - 1; // The timers of the rest of the window.
+        window.clear();
+        decreaseWindow();
+        return true;
+    }
+    // Used when an ACK arrives. Returns whether it acknowledged the window base, which slides the window past every frame it acknowledges.
+    bool ackReceived(int ackNum)
+    {
+        // An ACK carries the sequence number the receiver awaits: it acknowledges the frames before it, 1 to window.size() of them.
+        int acknowledged = seqs.diff(ackNum, seqBeg);
+        if(acknowledged == 0 || acknowledged > window.size())
+            return false;
+        seqBeg = ackNum;
+        next += acknowledged;
+        stoppedTimeouts += acknowledged;
+        window.slide(acknowledged);
+        // The additive increase: a frame more once a whole window was acknowledged.
+        for(int i=0; adaptive && i<acknowledged; i++)
+            congestionWindow = std::min(double(windowSize), congestionWindow + 1 / congestionWindow);
+        return true;
+    }
+    // Used for fast retransmit when a NACK arrives. Returns whether the sender goes back to the NACKed frame right away.
+    bool nackReceived(int ackNum)
+    {
+        int offset = seqs.diff(ackNum, seqBeg);
+        // Ignore NACKs for frames outside the window and repeated NACKs for a frame that was already retransmitted.
+        if(!seqs.inWindow(ackNum, seqBeg, window.size()) || next + offset == lastNack)
+            return false;
+        // The frames before the NACKed one were received correctly, so slide the window over them.
+        seqBeg = seqs.add(seqBeg, offset);
+        next += offset;
+        stoppedTimeouts += offset;
+        window.slide(offset);
+        lastNack = next;
+        // Stop the timers of all the frames that are going to be retransmitted.
+        stoppedTimeouts += window.size();
+        window.clear();
+        decreaseWindow();
+        return true;
+    }
+    // Used to send the messages that fit the window after the frames already in flight.
+    void fillWindow(GbnTransport& transport)
+    {
+        for(int i=window.size(); i<sendWindow(); i++){
+            long j = next + i;
+            if(j >= messageCount)
+                break;
+            int seqNum = seqs.add(seqBeg, i);
+            double sendTime = transport.sendData(j, seqNum, i);
+            window.push(j, seqNum, sendTime);
+        }
+    }
+};
+
+// The frames a sender may have in flight when its receiver answers the discarded frames (GbnReceiver::reAck): an ACK for
+// a whole window must not look like one for the window base, which takes a spare sequence number. The n-bit spaces always
+// have one; with the legacy numbering modulo WS the sender keeps one frame fewer in flight.
+template<typename SeqNumbers>
+int reAckWindowSize(const SeqNumbers& seqs, int windowSize)
+{
+    if(seqs.size() < 2)
+        throw std::invalid_argument("Sequence numbers modulo a window size of 1 can't tell a new frame from a resent one, use a larger window or n-bit numbers");
+    return std::min(windowSize, seqs.size() - 1);
+}
+
+/**
+ * The receiver side of a Go Back N flow. The awaited frame is answered with an ACK for the next sequence number when it is
+ * intact, with a NACK for itself when it is corrupted. With an ACK loss probability the answer may be lost; when the ACK of
+ * the awaited frame is, the receiver waits for the same frame again, so sender and receiver stay in step.
+ * Any other frame is discarded. Where ACKs can also be lost on the way after the receiver moved on (a channel model, a real
+ * network), reAck answers every discarded frame with an ACK for the awaited sequence number again (lost with the same
+ * probability), so the sender learns how far the receiver got. Without it a discarded frame draws nothing.
+ */
+template<typename SeqNumbers>
+struct GbnReceiver
+{
+    SeqNumbers seqs; // The sequence-number space.
+    int expected = 0; // Sequence number of the awaited frame.
+    double ackLossProbability = -1; // Probability of losing an answer, negative for no loss (and no random draws).
+    bool reAck = false; // Whether the discarded frames are answered too.
+
+    void reset(const SeqNumbers& seqNumbers, double lossProbability, bool answerDiscarded = false)
+    {
+        seqs = seqNumbers;
+        expected = 0;
+        ackLossProbability = lossProbability;
+        reAck = answerDiscarded;
+    }
+    // Used when a data frame arrives. Returns whether it was accepted, i.e. its message is delivered.
+    bool dataReceived(int seqNum, bool intact, GbnRandom& random, GbnTransport& transport)
+    {
+        if(seqNum != expected && !reAck)
+            return false;
+        bool lost = false;
+        if(ackLossProbability >= 0){
+            int randomOccurance = int(random.uniform(0, 100));
+            lost = (randomOccurance + 1) / 100.0 <= ackLossProbability;
+        }
+        if(seqNum != expected){
+            transport.sendControl(expected, false, lost);
+            return false;
+        }
+        int ackNum = intact ? seqs.add(seqNum, 1) : seqs.wrap(seqNum);
+        if(intact && !lost)
+            expected = seqs.add(expected, 1);
+        transport.sendControl(ackNum, !intact, lost);
+        return intact && !lost;
+    }
+};
+
+#endif /* GBN_H_ */
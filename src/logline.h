@@ -0,0 +1,89 @@
+/*
+ * logline.h
+ *
+ *  Formatting of the output file lines.
+ *
+ */
+#ifndef LOGLINE_H_
+#define LOGLINE_H_
+
+#include <charconv>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * The 8 bits of every byte value as characters, most significant bit first (the same as std::bitset<8>::to_string()).
+ */
+struct TrailerTable
+{
+    char bits[256][8];
+    constexpr TrailerTable() : bits()
+    {
+        for(int byte = 0; byte < 256; byte++)
+            for(int i = 0; i < 8; i++)
+                bits[byte][i] = ((byte >> (7 - i)) & 1) ? '1' : '0';
+    }
+};
+inline constexpr TrailerTable trailerTable;
+
+/**
+ * A reusable buffer the output file lines are formatted into. The buffer only grows, so once it fits the longest line
+ * formatting a line allocates nothing: the numbers are written in place with std::to_chars and the trailers are copied
+ * from the precomputed table.
+ */
+class LogLine
+{
+  public:
+    LogLine() : buffer(256) {}
+    LogLine& clear() { length = 0; return *this; }
+    LogLine& operator<<(const char *s) { return append(s, std::strlen(s)); }
+    LogLine& operator<<(const std::string& s) { return append(s.data(), s.size()); }
+    LogLine& operator<<(char c) { return append(&c, 1); }
+    LogLine& operator<<(int n)
+    {
+        char *begin = reserve(12);
+        length = std::to_chars(begin, begin + 12, n).ptr - buffer.data();
+        return *this;
+    }
+    // Writes a time the way the output file always had it: the integer part, then the tenths only when they are not 0.
+    LogLine& time(double t)
+    {
+        int whole = int(t);
+        *this << whole;
+        int tenths = int((t - whole) * 10);
+        if(tenths != 0)
+            *this << '.' << tenths;
+        return *this;
+    }
+    // Writes the 8 bits of a trailer byte.
+    LogLine& trailer(unsigned char byte) { return append(trailerTable.bits[byte], 8); }
+    const char *data() const { return buffer.data(); }
+    size_t size() const { return length; }
+    std::string str() const { return std::string(buffer.data(), length); }
+
+  private:
+    std::vector<char> buffer;
+    size_t length = 0;
+    // Makes room for n more characters and returns where they go.
+    char *reserve(size_t n)
+    {
+        if(length + n > buffer.size())
+            buffer.resize(2 * (length + n));
+        return buffer.data() + length;
+    }
+    LogLine& append(const char *s, size_t n)
+    {
+        std::memcpy(reserve(n), s, n);
+        length += n;
+        return *this;
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const LogLine& line)
+{
+    return os.write(line.data(), line.size());
+}
+
+#endif /* LOGLINE_H_ */
@@ -0,0 +1,34 @@
+/*
+ * memstats.cc
+ *
+ *  Reading the resident set size of the process.
+ *
+ */
+#include "memstats.h"
+
+#ifdef _WIN32
+#define PSAPI_VERSION 2 // GetProcessMemoryInfo from kernel32, no psapi library to link.
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+long long peakResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return (long long)counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return (long long)usage.ru_maxrss; // Bytes on macOS.
+#else
+    return (long long)usage.ru_maxrss * 1024; // Kilobytes on Linux.
+#endif
+#endif
+}
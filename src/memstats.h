@@ -0,0 +1,71 @@
+/*
+ * memstats.h
+ *
+ *  Accounting of the memory a run uses.
+ *
+ */
+#ifndef MEMSTATS_H_
+#define MEMSTATS_H_
+
+// The kinds of frames counted apart: data frames, ACKs and NACKs, timers and deferred trace lines.
+enum FrameKind { DATA_FRAME, CONTROL_FRAME, TIMER_FRAME, LOG_FRAME, FRAME_KINDS };
+
+/**
+ * What the run holds in memory, with the peak of every figure. The frames are counted by kind by the MessageFrame
+ * constructors, destructor and frame type setter, the input bytes by the nodes holding the input files and the trace
+ * bytes by the nodes deferring trace lines and writing them. A process runs one simulation at a time,
+ * so a single account is enough; the Coordinator starts its peaks over at the beginning of every run and reports them.
+ */
+struct MemoryAccount
+{
+    long frames = 0; // Live MessageFrame objects: in the future event set, in the link queues or being handled.
+    long peakFrames = 0;
+    long kindFrames[FRAME_KINDS] = {}; // The live frames by kind; the data ones include the coordinator's and the link's messages.
+    long peakKindFrames[FRAME_KINDS] = {};
+    long inputBytes = 0; // Messages and error codes of the input files held by the senders.
+    long peakInputBytes = 0;
+    long traceBytes = 0; // Trace lines waiting in the future event set to be written at their time.
+    long peakTraceBytes = 0;
+    static const char *frameKindName(int kind)
+    {
+        static const char *names[FRAME_KINDS] = {"data", "control", "timer", "log"};
+        return names[kind];
+    }
+    void addFrames(int kind, long n)
+    {
+        frames += n;
+        if(frames > peakFrames)
+            peakFrames = frames;
+        kindFrames[kind] += n;
+        if(kindFrames[kind] > peakKindFrames[kind])
+            peakKindFrames[kind] = kindFrames[kind];
+    }
+    void addInputBytes(long n)
+    {
+        inputBytes += n;
+        if(inputBytes > peakInputBytes)
+            peakInputBytes = inputBytes;
+    }
+    void addTraceBytes(long n)
+    {
+        traceBytes += n;
+        if(traceBytes > peakTraceBytes)
+            peakTraceBytes = traceBytes;
+    }
+    // Used to start the peaks of a new run from what is live now.
+    void resetPeaks()
+    {
+        peakFrames = frames;
+        for(int k=0; k<FRAME_KINDS; k++)
+            peakKindFrames[k] = kindFrames[k];
+        peakInputBytes = inputBytes;
+        traceBytes = 0; // The deferred lines of an earlier run went with its future event set, unwritten.
+        peakTraceBytes = 0;
+    }
+};
+inline MemoryAccount memoryAccount;
+
+// Peak resident set size of the process in bytes so far, 0 where it can't be read.
+long long peakResidentBytes();
+
+#endif /* MEMSTATS_H_ */
@@ -0,0 +1,53 @@
+/*
+ * messageframe.h
+ *
+ *  The frame class of MessageFrame.msg, customizing the generated MessageFrame_Base.
+ *
+ */
+#ifndef MESSAGEFRAME_H_
+#define MESSAGEFRAME_H_
+
+#include <cstring>
+#include "MessageFrame_m.h"
+#include "memstats.h"
+
+/**
+ * The MessageFrame that MessageFrame.msg leaves to be written (@customize). Every frame is created as one, so its
+ * constructors and destructor count the live frames on the memory account and the generated code stays as generated.
+ * A frame is counted by the kind of its frame type, which setFrameType() moves it between; the node's timers are the
+ * data type frames named "Timeout".
+ */
+class MessageFrame : public MessageFrame_Base
+{
+  public:
+    MessageFrame(const char *name=nullptr, short kind=0) : MessageFrame_Base(name, kind),
+            countedKind(name && std::strcmp(name, "Timeout") == 0 ? TIMER_FRAME : DATA_FRAME) { memoryAccount.addFrames(countedKind, 1); }
+    MessageFrame(const MessageFrame& other) : MessageFrame_Base(other), countedKind(other.countedKind) { memoryAccount.addFrames(countedKind, 1); }
+    virtual ~MessageFrame() { memoryAccount.addFrames(countedKind, -1); }
+    MessageFrame& operator=(const MessageFrame& other)
+    {
+        MessageFrame_Base::operator=(other);
+        recount(other.countedKind);
+        return *this;
+    }
+    virtual MessageFrame *dup() const override { return new MessageFrame(*this); }
+    virtual void setFrameType(int frameType) override
+    {
+        MessageFrame_Base::setFrameType(frameType);
+        recount(frameType == -1 ? LOG_FRAME : frameType > 0 ? CONTROL_FRAME : countedKind == TIMER_FRAME ? TIMER_FRAME : DATA_FRAME);
+    }
+    // Used by the deferred trace lines to copy a line into the payload's own buffer, which a reused frame already has.
+    void assignPayload(const char *data, size_t size) { payload.assign(data, size); }
+    const std::string& payloadRef() const { return payload; }
+
+  private:
+    int countedKind; // The FrameKind the frame is counted as.
+    void recount(int kind)
+    {
+        memoryAccount.addFrames(countedKind, -1);
+        countedKind = kind;
+        memoryAccount.addFrames(countedKind, 1);
+    }
+};
+
+#endif /* MESSAGEFRAME_H_ */
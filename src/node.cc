@@ -8,361 +8,902 @@
 #include <omnetpp.h>
 #include <fstream>
 #include <vector>
-#include <queue>
+#include <map>
 #include <bitset>
-#include "MessageFrame_m.h"
+#include <iomanip>
+#include <memory>
+#include <cstdlib>
+#include "messageframe.h"
+#include "seqnum.h"
+#include "checkpoint.h"
+#include "logline.h"
+#include "gbn.h"
+#include "checksum.h"
+#include "frameimage.h"
+#include "memstats.h"
+#include "tracewriter.h"
+#include "steadystate.h"
+#include "frametrain.h"
+#include "counters.h"
+#include "counterrandom.h"
 typedef std::bitset<8> bits;
 
-#define flag '$'
-#define escape '/'
+#define flag FRAME_FLAG
+#define escape FRAME_ESCAPE
+// Kinds of the self messages used by the link model.
+#define LINK_READY 1 // A processed frame is ready to be queued for the link.
+#define LINK_FREE 2 // The link finished transmitting the previous frame.
 using namespace omnetpp;
 
+/// Node Policies
+// Compile-time choices of the node, so the ones a run doesn't need cost nothing on the hot path.
+// The default policy leaves everything to the parameters of the run, the others fix a part of it when compiled.
+struct DefaultPolicy
+{
+    static constexpr bool trace = true; // Whether the trace lines (EV and output.txt) are built at all.
+    typedef SeqSpace SeqNumbers; // The sequence-number space, any seqNumBits and WS.
+    typedef ParityChecksum Checksum; // The trailer of the data frames.
+};
+// Used by headless batch runs: every trace line is compiled out.
+struct FastPolicy : DefaultPolicy
+{
+    static constexpr bool trace = false;
+};
+// Used with 8-bit sequence numbers: wrapping them is a constant mask.
+struct Seq8Policy : DefaultPolicy
+{
+    typedef FixedSeqSpace<8> SeqNumbers;
+};
+struct FastSeq8Policy : Seq8Policy
+{
+    static constexpr bool trace = false;
+};
+// Used to check the data frames with a CRC-8 instead of the parity.
+struct CrcPolicy : DefaultPolicy
+{
+    typedef Crc8Checksum Checksum;
+};
+
+/**
+ * The state of one Go Back N flow (one session of the coordinator) at one of its two nodes.
+ * A node keeps one per flow it takes part in, so several flows in both directions can share its link.
+ * The protocol state itself is in the simulator-independent core (gbn.h), the rest is what the node needs around it.
+ */
+template<typename SeqNumbers>
+struct FlowState
+{
+    bool sender = false; // Used to indicate if the node is the sender or the receiver of the flow.
+    bool initial = true; // Used to receive the first initialization message of the coordinator.
+    GbnSender<SeqNumbers> tx; // Used by the sender: the window, its sequence numbers and its timers.
+    GbnReceiver<SeqNumbers> rx; // Used by the receiver: the awaited sequence number and the ACK loss.
+    double lastTime = 0.0; // Used in scheduling the next message to send.
+    int logSeqNum = -1; // Used to help in printing the log of reading the line.
+    std::string inputFile; // Used to keep the name of the input file the coordinator gave the sender.
+    std::vector<std::string> errors,messages; // Used to store all the messages and their channel errors from the input file instead of reading the file multiple times.
+    std::vector<bool> moreFragments; // Used to mark the messages that are fragments of a longer line and are followed by more of them.
+    std::unique_ptr<const FrameImage> image; // Used to send the frames of a binary input file as mapped, instead of messages, errors and moreFragments.
+    std::vector<bool> errorsCleared; // Used with a binary input file to mark the frames whose error code was cleared, the image is read-only.
+    long inputBytes = 0; // Used to keep the size of the messages and errors on the memory account.
+    std::string reassembly; // Used by the receiver to put the fragments of a line back together.
+    long deliveredBytes = 0; // Used to compute the goodput at the receiver.
+    simtime_t launchTime; // Used to compute the goodput of the flow from when the coordinator launched it.
+    simtime_t lastDelivery; // Used to compute the goodput at the receiver.
+    cQueue txQueue; // Used to hold the processed frames waiting for the link to be free.
+    long deficit = 0; // Used by the link scheduler: what the flow may still send in its turn.
+    long sentFrames = 0; // Used to count the data frames the sender sent, retransmissions included.
+    long ackLossDraws = 0; // Used to number the receiver's ACK loss draws, the last word of their counter-based counters.
+    size_t messageCount() const { return image ? image->count() : messages.size(); }
+    std::string errorCode(size_t j) const { return !image ? errors[j] : errorsCleared[j] ? "0000" : image->errorCode(j); }
+    void clearErrorCode(size_t j)
+    {
+        if(image)
+            errorsCleared[j] = true;
+        else
+            errors[j] = "0000";
+    }
+};
+
 /**
  * Derive the Node class from cSimpleModule. This is the class where a node can be a sender or a receiver.
  * If it's a sender then it processes the messages in the window it needs to send, sends them and awaits a corresponding ACK for each.
  * It also sets a timer (by self-messaging) to re-send the whole window again in case of the absence of awaited ACKs and times out.
  * The receiver however can only receive the message it's waiting for (identifies this by the sequence number) and send an ACK in case of
  * a message with correct parity or a NACK in case of incorrect parity.
+ * A node can take part in several flows at once, as the sender of some and the receiver of others. Every frame carries its flow id
+ * and each flow has its own window, timers and sequence numbers. On a datarate link the flows take turns through a round robin
+ * or deficit round robin scheduler; with the fixed TD delay the link has no capacity limit, so the flows don't contend.
+ * With an mtu the sender splits the lines that don't fit a frame into fragments, each one sent, acknowledged and retransmitted
+ * as a frame of its own, and the receiver delivers a line once its last fragment arrives.
+ * An input file can also be a binary image made by tools/gbnimage: the sender maps it and sends its stuffed payloads and trailers as they are.
+ * With windowTrain the data frames a sender sends for a window go out as one FrameTrain instead of a message each.
+ * With a steadyStatePrecision a receiver estimates its steady-state goodput and delay by batch means, and the run ends as soon as
+ * the estimates of every receiver are that precise.
+ * With counterRandom the modified bits and the ACK losses come from counter-based streams keyed by flow, sequence number and
+ * purpose instead of the module's RNG, so adding flows or reordering events leaves the draws of every other frame as they were.
+ * The class is a template over the compile-time policy (tracing, sequence-number space and trailer); Node, the fully run time
+ * configurable one, FastNode, Seq8Node, FastSeq8Node and CrcNode are the registered subclasses of its instantiations.
  */
-class Node : public cSimpleModule
+template<typename Policy>
+class ProtocolNode : public cSimpleModule, public Checkpointable, public Counted
 {
   protected:
+    typedef FlowState<typename Policy::SeqNumbers> Flow;
+    /**
+     * The adapter between the protocol core and the node for the event being handled: the core decides which frames
+     * go out, the adapter builds them with their errors, timers and trace lines and sends them the node's way.
+     */
+    struct CoreAdapter : public GbnTransport, public GbnRandom
+    {
+        ProtocolNode *node;
+        Flow& flow;
+        MessageFrame_Base *msg; // The message being handled.
+        double delays; // PT + TD.
+        double newDelay = 0; // Used to delay every frame after the previous one.
+        double newTime = 0; // Used as the time the frame being sent leaves the node.
+        bool noErrors = false; // Used to be able to send the first frame after a timeout error free.
+        CoreAdapter(ProtocolNode *node, Flow& flow, MessageFrame_Base *msg, double delays) : node(node), flow(flow), msg(msg), delays(delays) {}
+        virtual double sendData(long index, int seqNum, int) override { return node->sendDataFrame(*this, index, seqNum); }
+        virtual void sendControl(int ackNum, bool nack, bool lost) override { node->sendControlFrame(*this, ackNum, nack, lost); }
+        virtual double uniform(double a, double b) override
+        {
+            if(!node->counterRandom)
+                return node->uniform(a, b);
+            return node->counterStreams.uniform(a, b, msg->getFlowId(), msg->getSeqNum(), ACK_LOSS_DRAW, flow.ackLossDraws++);
+        }
+    };
     /// Data members
-    bool sender = false; // Used to indicate if a node is a sender or a receiver of the Go Back N algorithm.
-    bool initial = true; // Used to receive the first initialization message of the coordinator.
-    int index = 0;  // Used to store the index of the node itself. (in our case 0 or 1).
-    int seqNum = 0; // Used to keep track of which messages were sent & acknowledged.
-    int seqBeg = 0; // Used to indicate the sequence number of the beginning of the window.
-    int stoppedTimeoutCount = 0; /* Used to keep count of the acknowledgments received from the receiver and its timer hasn't timed out yet.
-    Used to avoid timing out on messages of which the sender already received an a acknowledgment.*/
-    double lastTime = 0.0; // Used in scheduling the next message to send.
-    int logSeqNum = -1; // Used to help in printing the log of reading the line.
-    std::queue<bool> sentFlag; //Used to indicate the amount of the messages in the window that have been sent.
-    std::vector<std::string> errors,messages; /* Used to store all the messages and their channel errors from the input file instead of reading the file multiple times.
-    The following redefined virtual function holds the algorithm.*/
+    int index = 0;  // Used to store the index of the node itself. (0 and 1 for the first pair).
+    std::map<int, Flow> flows; // Used to hold the state of every flow the node takes part in, by flow id.
+    typename Policy::SeqNumbers seqSpace; // Used to do all the sequence number arithmetic (wrapping, window checks).
+    bool nodeErrors = true; // Used to indicate that the node applies the input file error codes and the ACK loss itself.
+    bool useChannel = false; // Used to answer the discarded frames too: the channel module can lose ACKs after the receiver moved on.
+    // Used to keep the Network's timing and error parameters, read once instead of on every frame.
+    int windowSize = 1; // WS, one frame less with a channel module and the legacy numbering (see reAckWindowSize).
+    double processingTime = 0; // PT
+    double transmissionDelay = 0; // TD
+    double timeoutInterval = 0; // TO
+    double errorDelay = 0; // ED
+    double duplicationDelay = 0; // DD
+    double ackLossProbability = 0; // LP
+    bool fastRetransmit = false;
+    bool traceFile = true; // Used to indicate that the trace lines are written to output.txt.
+    LogLine line; // Used to format the trace lines without allocating.
+    std::vector<MessageFrame *> traceLinePool; // Used to reuse the messages of the written deferred trace lines.
+    std::ofstream outputStream; // Used to append the trace lines to the output file.
+    bool linkMode = false; // Used to indicate that frames go through a datarate link instead of the fixed TD delay.
+    MessageFrame_Base *linkFreeMsg = nullptr; // Used to wake the node up when the link finishes a transmission.
+    bool deficitRoundRobin = false; // Used to choose between round robin (a frame per turn) and deficit round robin (drrQuantum bytes per turn).
+    long drrQuantum = 0; // Used as the bytes a flow may send per turn with deficit round robin.
+    int turnFlow = -1; // Used to keep the flow whose turn it is on the link.
+    long mtu = 0; // Used as the largest frame in bytes, longer lines are sent as several fragments (0 for no limit).
+    bool adaptiveWindow = false; // Used to limit the senders' frames in flight by an AIMD congestion window instead of WS.
+    cOutVector windowVector; // Used to record the congestion window of the flows the node sends, whenever it changes.
+    SteadyStateDetector steadyState; // Used by a receiver to estimate its steady-state goodput and delay.
+    bool estimating = false; // Used to indicate that the node's estimates started and are not steady yet.
+    long steadyEvent = -1; // Used to keep the number of events it took the estimates to become steady.
+    bool windowTrain = false; // Used to send the data frames of a window as one FrameTrain.
+    FrameTrain *train = nullptr; // Used to collect the data frames of the window being sent.
+    bool counterRandom = false; // Used to draw the modified bits and the ACK losses from counterStreams instead of the module's RNG.
+    CounterRandom counterStreams; // Used to make every such draw a function of its flow, sequence number, purpose and draw number.
+    // The following redefined virtual function holds the algorithm.
     virtual void initialize() override;
     virtual void handleMessage(cMessage *msg) override;
-    // Byte Stuffing algorithm. It takes the index of the message to perform the byte stuffing on.
-    std::string byteStuffing(int seqNumber);
+    void handleFrame(MessageFrame_Base *mmsg, bool selfMessage); // Used to handle a frame, one that arrived or a self message.
+    virtual void finish() override;
+    // Used to check whether anybody consumes the trace lines (the output file or EV), so they are only built then.
+    bool tracing() const { return Policy::trace && (traceFile || getEnvir()->isLoggingEnabled()); }
+  public:
+    virtual ~ProtocolNode();
+    /// Checkpoint Functions
+    virtual void saveState(std::ostream& os) override;
+    virtual void loadState(std::istream& is) override;
+    virtual void restoreEvent(MessageFrame_Base *msg, simtime_t arrivalTime, bool selfMessage) override;
+    /// Dashboard Functions
+    virtual void addCounters(ProtocolCounters& counters) const override;
+  protected:
+    void saveFlowState(std::ostream& os, const Flow& flow);
+    void loadFlowState(std::istream& is, Flow& flow);
+    /// Core Adapter Functions
+    double sendDataFrame(CoreAdapter& adapter, long j, int seqNumber); // Used to send message j of the flow, returns the time it leaves the node.
+    void sendControlFrame(CoreAdapter& adapter, int ackNum, bool nack, bool lost); // Used to answer the data frame being handled.
+    /// Link Helper Functions
+    // Used to send a frame that finishes processing after 'delay' (PT included, and TD too unless the link is a datarate one).
+    void sendFrame(MessageFrame_Base *frame, double delay);
+    // Used to write the trace line formatted in 'line' at 'time' instead of now, by a self message of the pool.
+    void deferTraceLine(double time);
+    void startTransmission(); // Used to put the next queued frame on the link once it is free.
+    int nextFlow(); // Used to pick the flow that sends the next frame on the link, -1 if no frame waits.
+    // Byte Stuffing algorithm. It takes the message to perform the byte stuffing on.
+    std::string byteStuffing(const std::string& message);
     /// File Helper Functions
-    void readInputFile(const char *filename); // Used to read the input file at the sender.
-    void writeOutputFile(const char *filename, std::string logMessage); // Used to write a line directly to the output file.
-    std::string writeOutputFileBP(const char *filename, double startingPT, int j, bool write=true); // Used to write the output line of reading input line before processing.
+    void readInputFile(const char *filename, Flow& flow); // Used to read the input file at the sender.
+    void writeOutputFile(const char *filename, const char *data, size_t size); // Used to write a line directly to the output file.
+    const LogLine& writeOutputFileBP(const char *filename, double startingPT, const std::string& code, bool write=true); // Used to write the output line of reading input line before processing.
     // Used to write the output line after processing the message and on sending it through the channel.
-    std::string writeOutputFileBT(const char *filename, double startingTR, std::string verb, int seqNumber, std::string payload, std::string trailer, int modified, bool mod, bool lost, int duplicate, double delay, bool write=true);
+    const LogLine& writeOutputFileBT(const char *filename, double startingTR, bool sender, const char *verb, int seqNumber, const std::string& payload, unsigned char trailer, int modified, bool mod, bool lost, int duplicate, double delay, bool write=true);
     // Used to write the output line on timeout event.
-    std::string writeOutputFileTO(const char *filename, double timeoutTime, int seqNumber, bool write=true);
+    const LogLine& writeOutputFileTO(const char *filename, double timeoutTime, int seqNumber, bool write=true);
+    // Used to write the output line on going back to a NACKed frame without waiting for its timeout.
+    const LogLine& writeOutputFileFR(const char *filename, double nackTime, int seqNumber, bool write=true);
     // Used to write the output line after processing and on sending the control frame through the channel.
-    std::string writeOutputFileCF(const char *filename, double startingTR, bool nack, int ackNum, bool loss, bool write=true);
+    const LogLine& writeOutputFileCF(const char *filename, double startingTR, bool nack, int ackNum, bool loss, bool write=true);
 };
 
-// The module class needs to be registered with OMNeT++
+// The module classes need to be registered with OMNeT++. Register_Class names a class after its typeid, so every
+// instantiation is a class of its own: a typedef would be registered as ProtocolNode<...> and the NED types wouldn't find it.
+class Node : public ProtocolNode<DefaultPolicy> {};
+class FastNode : public ProtocolNode<FastPolicy> {};
+class Seq8Node : public ProtocolNode<Seq8Policy> {};
+class FastSeq8Node : public ProtocolNode<FastSeq8Policy> {};
+class CrcNode : public ProtocolNode<CrcPolicy> {};
 Define_Module(Node);
+Define_Module(FastNode);
+Define_Module(Seq8Node);
+Define_Module(FastSeq8Node);
+Define_Module(CrcNode);
+Register_Class(MessageFrame);
 
-void Node::initialize()
+template<typename Policy>
+void ProtocolNode<Policy>::initialize()
 {
+    seqSpace = typename Policy::SeqNumbers(getParentModule()->par("seqNumBits"), getParentModule()->par("WS"));
+    linkMode = double(getParentModule()->par("linkDatarate")) > 0;
+    nodeErrors = getParentModule()->par("nodeErrors");
+    useChannel = getParentModule()->par("useChannel");
+    windowSize = getParentModule()->par("WS");
+    if(useChannel)
+        windowSize = reAckWindowSize(seqSpace, windowSize);
+    processingTime = getParentModule()->par("PT");
+    transmissionDelay = getParentModule()->par("TD");
+    timeoutInterval = getParentModule()->par("TO");
+    errorDelay = getParentModule()->par("ED");
+    duplicationDelay = getParentModule()->par("DD");
+    ackLossProbability = getParentModule()->par("LP");
+    fastRetransmit = getParentModule()->par("fastRetransmit");
+    traceFile = getParentModule()->par("writeTrace");
+    linkFreeMsg = new MessageFrame("linkFree", LINK_FREE);
+    std::string scheduler = getParentModule()->par("linkScheduler").stdstringValue();
+    if(scheduler != "rr" && scheduler != "drr")
+        throw cRuntimeError("Unknown link scheduler '%s', use rr or drr", scheduler.c_str());
+    deficitRoundRobin = scheduler == "drr";
+    drrQuantum = getParentModule()->par("drrQuantum");
+    // The deficits only grow by the quantum, without one the scheduler would never find a flow to send.
+    if(deficitRoundRobin && drrQuantum < 1)
+        throw cRuntimeError("A drrQuantum of %ld bytes is too small, use at least 1", drrQuantum);
+    mtu = getParentModule()->par("mtu");
+    adaptiveWindow = getParentModule()->par("adaptiveWindow");
+    double precision = getParentModule()->par("steadyStatePrecision");
+    long batchSize = getParentModule()->par("steadyStateBatch");
+    if(precision > 0 && batchSize < 1)
+        throw cRuntimeError("A steadyStateBatch of %ld lines is too small, use at least 1", batchSize);
+    // The estimates are not part of a checkpoint, nor is the time every frame in flight left its sender.
+    if(precision > 0 && (double(getParentModule()->par("checkpointAt")) > 0 || bool(getParentModule()->par("restoreCheckpoint"))))
+        throw cRuntimeError("Steady-state detection needs a run without checkpoints (steadyStatePrecision = 0)");
+    steadyState.reset(precision, batchSize, 0);
+    windowTrain = getParentModule()->par("windowTrain");
+    // The trains need the fixed delay straight to the other node, and a checkpoint saves the frames on their way one by one.
+    if(windowTrain && (linkMode || useChannel))
+        throw cRuntimeError("Window trains need the fixed delay model (linkDatarate = 0 and useChannel = false)");
+    if(windowTrain && (double(getParentModule()->par("checkpointAt")) > 0 || bool(getParentModule()->par("restoreCheckpoint"))))
+        throw cRuntimeError("Window trains need a run without checkpoints (windowTrain = false)");
+    windowVector.setName("window");
+    counterRandom = getParentModule()->par("counterRandom");
+    // The run's seed-set is the key, so the repetitions of a run differ as they do with the RNGs.
+    if(counterRandom)
+        counterStreams.setKey(std::strtoull(getEnvir()->getConfigEx()->getVariable(CFGVAR_SEEDSET), nullptr, 10));
+    // A fragment needs room for its header, both flags and at least one (escaped) character.
+    if(mtu != 0 && mtu < FRAME_OVERHEAD + 4)
+        throw cRuntimeError("An mtu of %ld bytes is too small, use 0 or at least %d", mtu, FRAME_OVERHEAD + 4);
+    // node0 and node1 are nodes 0 and 1, the nodes of the extra pairs follow them.
+    if(isVector())
+        index = getIndex() + 2;
+    else if(isName("node0"))
+        index = 0;
+    else
+        index = 1;
+}
+
+template<typename Policy>
+ProtocolNode<Policy>::~ProtocolNode()
+{
+    cancelAndDelete(linkFreeMsg);
+    for(MessageFrame *logMsg : traceLinePool)
+        delete logMsg;
+    for(auto& f : flows)
+        memoryAccount.addInputBytes(-f.second.inputBytes);
 }
 
-void Node::handleMessage(cMessage *msg)
+template<typename Policy>
+void ProtocolNode<Policy>::handleMessage(cMessage *msg)
 {
+    // A window train: its next frame is handled as if it had arrived on its own, the train comes back for the one after it.
+    if(windowTrain && msg->getKind() == WINDOW_TRAIN){
+        FrameTrain *train = check_and_cast<FrameTrain *>(msg);
+        MessageFrame_Base *frame = train->pop();
+        // Scheduled before the frame is handled, like the frame that would have been on its way since it was sent.
+        if(train->empty())
+            delete train;
+        else
+            scheduleAt(train->nextArrival(), train);
+        handleFrame(frame, false);
+        return;
+    }
     MessageFrame_Base *mmsg = check_and_cast<MessageFrame_Base *> (msg); // Casting from the general message class to the custom made one.
-    double delays =  double(getParentModule()->par("PT"))+double(getParentModule()->par("TD"));
+    handleFrame(mmsg, mmsg->isSelfMessage());
+}
+
+template<typename Policy>
+void ProtocolNode<Policy>::handleFrame(MessageFrame_Base *mmsg, bool selfMessage)
+{
+    double delays = processingTime + transmissionDelay;
     bool timeOut = false; // Used to indicate whether a timeout event occurs.
-    bool receivedAck = false; // Used to indicate whether the correct ACK was received.
-    bool noErrors = false; // Used to be able to send the first frame after a timeout error free.
-    // For logging purposes.
-    std::string log;
-    if(mmsg->isSelfMessage() && mmsg->getFrameType() == -1){
-        writeOutputFile("output.txt", mmsg->getPayload());
-        EV<<mmsg->getPayload();
-        cancelAndDelete(msg);
+    bool steady = false; // Used to end the run after the event once the estimates of every receiver are steady.
+    // The link model events: a frame finished processing, or the link is free again.
+    if(selfMessage && mmsg->getKind() == LINK_READY){
+        mmsg->setKind(0);
+        flows[mmsg->getFlowId()].txQueue.insert(mmsg);
+        startTransmission();
+        return;
+    } else if(mmsg == linkFreeMsg){
+        startTransmission();
         return;
+    }
+    // Control frames have no checksum of their own, so the ones corrupted by the channel are dropped as lost.
+    if(!selfMessage && mmsg->getFrameType() != 0 && mmsg->hasBitError()){
+        cancelAndDelete(mmsg);
+        return;
+    }
+    if(selfMessage && mmsg->getFrameType() == -1){
+        MessageFrame *logMsg = check_and_cast<MessageFrame *>(mmsg);
+        const std::string& logMessage = logMsg->payloadRef();
+        if(traceFile)
+            writeOutputFile("output.txt", logMessage.data(), logMessage.size());
+        EV<<logMessage;
+        memoryAccount.addTraceBytes(-long(logMessage.size()));
+        traceLinePool.push_back(logMsg);
+        return;
+    }
+    Flow& flow = flows[mmsg->getFlowId()]; // The flow the event belongs to.
+    CoreAdapter adapter(this, flow, mmsg, delays);
+    double congestionWindow = flow.tx.congestionWindow; // Used to record the window once the event changed it.
     // Check for timeouts in sender.
-    } else if(mmsg->isSelfMessage() && seqNum<messages.size()){
-        // Check if the timer was already stopped either by receiving an ACK or by another timeout being triggered.
-        if(stoppedTimeoutCount>0)
-            stoppedTimeoutCount--;
-        else {
+    if(selfMessage){
+        // The timer may have been stopped either by receiving an ACK or by another timeout being triggered.
+        if(flow.tx.timerFired()){
             timeOut = true;
-            noErrors = true;
-            log = writeOutputFileTO("output.txt", simTime().dbl(), seqNum%int(getParentModule()->par("WS")));
-            EV<<log;
-            while(!sentFlag.empty())
-            {
-                sentFlag.pop();
-                stoppedTimeoutCount++; // Avoid the timeouts of the rest of the window.
-            }
-            stoppedTimeoutCount--;
+            adapter.noErrors = true;
+            if(tracing())
+                EV<<writeOutputFileTO("output.txt", simTime().dbl(), seqSpace.wrap(flow.tx.next));
+        }
+    }
+    // Fast retransmit: a NACK for a frame in the window goes back to it right away instead of waiting for its timer.
+    else if(flow.sender && mmsg->getFrameType() == 2 && fastRetransmit){
+        if(flow.tx.nackReceived(mmsg->getAckNum())){
+            timeOut = true; // Retransmit the window the same way a timeout does.
+            adapter.noErrors = true;
+            if(tracing())
+                EV<<writeOutputFileFR("output.txt", simTime().dbl(), flow.tx.seqBeg);
         }
     }
     // Initialize sender and receiver settings.
     std::string receiving ="No";
-    if(initial && mmsg->getPayload() == receiving){// Initialize receiver
-        initial = false;
-        cancelAndDelete(msg); // Release resources.
-        if(isName("node0"))
-            index = 0;
-        else
-            index = 1;
+    if(flow.initial && mmsg->getPayload() == receiving){// Initialize receiver
+        flow.initial = false;
+        flow.launchTime = simTime();
+        flow.rx.reset(seqSpace, nodeErrors ? ackLossProbability : -1, useChannel);
+        // The estimates start with the first flow the node receives, the Coordinator counted the node from the start.
+        if(steadyState.precision > 0 && !estimating && steadyEvent < 0){
+            estimating = true;
+            steadyState.reset(steadyState.precision, steadyState.batchSize, simTime().dbl());
+        }
+        cancelAndDelete(mmsg); // Release resources.
         return;
-    } else if(initial) {// Initialize sender
-        sender = true;
-        if(isName("node0"))
-            index = 0;
-        else
-            index = 1;
-        seqBeg = 0;
-        std::string fileName = "input"+std::to_string(index)+".txt";
+    } else if(flow.initial) {// Initialize sender
+        flow.sender = true;
+        flow.inputFile = mmsg->getName(); // The coordinator names its message after the input file to send.
         // Reading all the messages at one and storing them in a vector with their errors.
         // Just to avoid reading the file multiple times.
-        readInputFile(fileName.c_str());
+        readInputFile(flow.inputFile.c_str(), flow);
+        flow.tx.reset(seqSpace, windowSize, flow.messageCount(), adaptiveWindow);
     }
     // Sender handler.
-    if(sender){
+    if(flow.sender){
         // Send messages in 3 cases: Initial state, Timeout State & Receiving the correct ACK (since we move the window).
-        if(mmsg->getFrameType() == 1 || initial || timeOut){
-            // Check if the received ACK is the one the sender is waiting for.
-            if(!timeOut && mmsg->getAckNum() == (seqBeg+1)%int(getParentModule()->par("WS")))
-            {
-                // Move the window.
-                seqBeg++;
-                seqBeg %= (int(getParentModule()->par("WS")));
-                seqNum++;
-                stoppedTimeoutCount++; // Avoid its timeout/stop its timer.
-                sentFlag.pop();
-                receivedAck = true;
-            }
+        if(mmsg->getFrameType() == 1 || flow.initial || timeOut){
+            // Check if the received ACK is the one the sender is waiting for, it moves the window.
+            if(!timeOut)
+                flow.tx.ackReceived(mmsg->getAckNum());
             // If there are still messages the sender wants to send.
-            if(seqNum<messages.size()){
-                double newDelay = 0;
-                if (lastTime > simTime().dbl())
-                    newDelay = lastTime - simTime().dbl();
-                double newTime = simTime().dbl();
-                if(timeOut){
-                    newDelay = 0;
-                    newTime = simTime().dbl();
-                    timeOut = false;
-                }
-                if(receivedAck){
-                    newTime = simTime().dbl();
-                    receivedAck = false;
+            if(!flow.tx.done()){
+                if (flow.lastTime > simTime().dbl())
+                    adapter.newDelay = flow.lastTime - simTime().dbl();
+                adapter.newTime = simTime().dbl();
+                if(timeOut)
+                    adapter.newDelay = 0;
+                // Send from the correct position in the window.
+                if(windowTrain){
+                    train = new FrameTrain();
+                    // The frames are on their way since they were sent, so they go before the events scheduled later for the same time.
+                    train->setSchedulingPriority(-1);
                 }
-                // Start from the correct position in the window.
-                for(int i=sentFlag.size(); i<int(getParentModule()->par("WS")); i++){
-                    if(initial){// Add the starting time for the initial send.
-                        newDelay += std::stod(mmsg->getPayload());
-                        newTime += std::stod(mmsg->getPayload());
-                        initial = false;
-                    }
-                    int j = seqNum + i;
-                    if(j >= messages.size()) // If there are no more messages to send, exit.
-                        break;
-                    // Perform byte stuffing on message.
-                    std::string value = byteStuffing(j);
-                    bool modificationE = false;
-                    bool lossE = false;
-                    bool duplicationE = false;
-                    bool delayE = false;
-                    // In case of timeout, send the first message in the window error free while the other messages with their errors.
-                    if(!noErrors){
-                        if(errors[j][0] == '1')
-                            modificationE = true;
-                        if(errors[j][1] == '1')
-                            lossE = true;
-                        if(errors[j][2] == '1')
-                            duplicationE = true;
-                        if(errors[j][3] == '1')
-                            delayE = true;
-                    }
-                    else
-                        errors[j] = "0000";
-                    noErrors = false;
-                    // Create a new message to send.
-                    MessageFrame_Base *newMsg = new MessageFrame_Base(value.c_str());
-                    newMsg->setPayload(value);
-                    newMsg->setSeqNum((seqBeg+i)%int(getParentModule()->par("WS")));
-                    // Add Parity/Trailer.
-                    bits parity(std::string("00000000"));
-                    for(int i=0; i<value.size(); i++)
-                    {
-                        bits temp(value[i]);
-                        parity = parity ^ temp;
-                    }
-                    newMsg->setParity(static_cast<char>( parity.to_ulong() ));
-                    newMsg->setFrameType(0); // i.e. data frame.
-                    newDelay += delays;
-                    newTime += double(getParentModule()->par("PT"));
-                    double temp = (newTime + double(getParentModule()->par("TO")));
-                    // Variable to ease printing logs
-                    int duplicate = 0;
-                    if(duplicationE)
-                        duplicate = 1;
-                    int seqNumber = (seqBeg+i)%int(getParentModule()->par("WS"));
-                    int errorDelay = double(getParentModule()->par("ED"));
-                    std::string payload = newMsg->getPayload();
-                    std::string trailer = bits(newMsg->getParity()).to_string();
-                    int modifiedBitNumber = 0;
-                    // Handle loss, delay, modification and duplication channel errors.
-                    if(!lossE){
-                        if(modificationE){
-                            std::string modifiedMsg = newMsg->getPayload();
-                            int randomI = int(uniform(0,modifiedMsg.size()));
-                            bits modifiedBits(modifiedMsg[randomI]);
-                            int randomBit = int(uniform(0,8));
-                            modifiedBits[randomBit] = ~modifiedBits[randomBit];
-                            modifiedMsg[randomI] = static_cast<char>( modifiedBits.to_ulong());
-                            newMsg->setPayload(modifiedMsg);
-                            newMsg->setName(modifiedMsg.c_str());
-                            payload = modifiedMsg;
-                            modifiedBitNumber = 8*randomI + randomBit;
-                        }
-                        if(delayE)
-                            sendDelayed(newMsg, newDelay + double(getParentModule()->par("ED")), "nodeGate$o");
-                        else
-                            sendDelayed(newMsg, newDelay, "nodeGate$o"); // send out the message
-                        if(delayE && duplicationE)
-                            sendDelayed(newMsg->dup(), newDelay + double(getParentModule()->par("ED")) + double(getParentModule()->par("DD")), "nodeGate$o");
-                        else if(duplicationE)
-                            sendDelayed(newMsg->dup(), newDelay + double(getParentModule()->par("DD")), "nodeGate$o"); // send out the message
-                    }
+                flow.tx.fillWindow(adapter);
+                if(train){
+                    if(train->empty())
+                        delete train;
                     else
-                        cancelAndDelete(newMsg); // If the message was lost, clear its resources.
-                    // Just some logging to the output file.
-                    if(simTime().dbl() + newDelay - delays != simTime().dbl()){
-                        if(j > logSeqNum){
-                            // Send a self message to write the output at its correct time.
-                            std::string m;
-                            m = writeOutputFileBP("output.txt", simTime().dbl() + newDelay - delays, j, false);
-                            MessageFrame_Base *logMsg = new MessageFrame_Base("");
-                            logMsg->setPayload(m);
-                            logMsg->setFrameType(-1);
-                            scheduleAt(simTime().dbl() + newDelay - delays, logMsg);
-                            logSeqNum++;
-                        }
-                    }
-                    else
-                    {
-                        if(j > logSeqNum){
-                            log = writeOutputFileBP("output.txt", simTime().dbl() + newDelay - delays, j);
-                            EV<<log;
-                            logSeqNum++;
-                        }
-                    }
-                    if(simTime().dbl() != newTime){
-                        std::string m1, m2;
-                        if(delayE)
-                            m1 = writeOutputFileBT("output.txt", newTime, "sent", seqNumber, payload, trailer, modifiedBitNumber, modificationE, lossE, duplicate, errorDelay, false);
-                        else
-                            m1 = writeOutputFileBT("output.txt", newTime, "sent", seqNumber, payload, trailer, modifiedBitNumber, modificationE, lossE, duplicate, 0.0, false);
-                        MessageFrame_Base *logMsg1 = new MessageFrame_Base("");
-                        logMsg1->setPayload(m1);
-                        logMsg1->setFrameType(-1);
-                        scheduleAt(newTime, logMsg1);
-                        if(delayE && duplicationE)
-                            m2 = writeOutputFileBT("output.txt", newTime+double(getParentModule()->par("DD")), "sent", seqNumber, payload, trailer, modifiedBitNumber, modificationE, lossE, duplicate+1, errorDelay, false);
-                        else if(duplicationE)
-                            m2 = writeOutputFileBT("output.txt", newTime+double(getParentModule()->par("DD")), "sent", seqNumber, payload, trailer, modifiedBitNumber, modificationE, lossE, duplicate+1, 0.0, false);
-                        if(duplicationE){
-                            MessageFrame_Base *logMsg2 = new MessageFrame_Base("");
-                            logMsg2->setPayload(m2);
-                            logMsg2->setFrameType(-1);
-                            scheduleAt(newTime+double(getParentModule()->par("DD")), logMsg2);
-                        }
-                    } else {
-                        if(delayE)
-                            log = writeOutputFileBT("output.txt", newTime, "sent", seqNumber, payload, trailer, modifiedBitNumber, modificationE, lossE, duplicate, errorDelay);
-                        else
-                            log = writeOutputFileBT("output.txt", newTime, "sent", seqNumber, payload, trailer, modifiedBitNumber, modificationE, lossE, duplicate, 0.0);
-                        EV<<log;
-                        if(delayE && duplicationE)
-                            log = writeOutputFileBT("output.txt", newTime+double(getParentModule()->par("DD")), "sent", seqNumber, payload, trailer, modifiedBitNumber, modificationE, lossE, duplicate+1, errorDelay);
-                        else if(duplicationE)
-                            log = writeOutputFileBT("output.txt", newTime+double(getParentModule()->par("DD")), "sent", seqNumber, payload, trailer, modifiedBitNumber, modificationE, lossE, duplicate+1, 0.0);
-                        EV<<log;
-                    }
-                    // Start Timer by self messaging.
-                    MessageFrame_Base *timerMsg = new MessageFrame_Base("Timeout");
-                    timerMsg->setSeqNum((seqBeg+i)%int(getParentModule()->par("WS")));
-                    scheduleAt(newTime + double(getParentModule()->par("TO")), timerMsg);
-                    sentFlag.push(true);
-                    newDelay -= double(getParentModule()->par("TD"));
+                        sendDelayed(train, train->nextArrival() - simTime(), "nodeGate$o");
+                    train = nullptr;
                 }
-                lastTime = newDelay + simTime().dbl();
+                flow.lastTime = adapter.newDelay + simTime().dbl();
             }
         }
+        if(adaptiveWindow && flow.tx.congestionWindow != congestionWindow)
+            windowVector.record(flow.tx.congestionWindow);
     // Receiver Handler
     } else {
-        // Check if the received message is the awaited one.
-        if(mmsg->getSeqNum() == seqNum){
-                bool ackLost = false;
-                int randomOccurance = int(uniform(0,100));
-                if((randomOccurance+1)/100.0 <= double(getParentModule()->par("LP")))
-                    ackLost = true;
-                seqNum++;
-                seqNum %= int(getParentModule()->par("WS"));
-                std::string name = "";
-                std::string payload = mmsg->getPayload();
-                bool noError = false;
-                int frameType = 2;
-                bits parity(std::string("00000000"));
-                for(int i=0; i<payload.size(); i++)
-                {
-                    bits temp(payload[i]);
-                    parity = parity ^ temp;
-                }
-                // Check if the received message has a correct parity.
-                bool sendack = static_cast<char>( parity.to_ulong() ) == mmsg->getParity();
-                if(sendack)
-                {
-                    noError = true;
-                    name = "ACK";
-                    frameType = 1;
-                } else {
-                    noError = false;
-                    name = "NACK";
-                    frameType = 2;
-                    seqNum--;
-                    seqNum += int(getParentModule()->par("WS"));
-                    seqNum %= int(getParentModule()->par("WS"));
-                }
-                MessageFrame_Base *ackMsg = new MessageFrame_Base(name.c_str());
-                if(sendack)
-                    ackMsg->setAckNum((mmsg->getSeqNum()+1)%int(getParentModule()->par("WS")));
-                else
-                    ackMsg->setAckNum((mmsg->getSeqNum())%int(getParentModule()->par("WS")));
-                ackMsg->setFrameType(frameType);
-                double newDelay = delays;
-                // Check if the ACK/NACK was lost and log it accordingly in the output file.
-                if(!ackLost){
-                    sendDelayed(ackMsg, newDelay,"nodeGate$o"); // send out the message
-                    std::string m;
-                    m = writeOutputFileCF("output.txt", simTime().dbl() + double(getParentModule()->par("PT")), !sendack, ackMsg->getAckNum(), ackLost, false);
-                    MessageFrame_Base *logMsg = new MessageFrame_Base("");
-                    logMsg->setPayload(m);
-                    logMsg->setFrameType(-1);
-                    scheduleAt(simTime().dbl() + double(getParentModule()->par("PT")), logMsg);
-                }
-                else{
-                    std::string m;
-                    m = writeOutputFileCF("output.txt", simTime().dbl() + double(getParentModule()->par("PT")), !sendack, ackMsg->getAckNum(), ackLost, false);
-                    MessageFrame_Base *logMsg = new MessageFrame_Base("");
-                    logMsg->setPayload(m);
-                    logMsg->setFrameType(-1);
-                    scheduleAt(simTime().dbl() + double(getParentModule()->par("PT")), logMsg);
-                    cancelAndDelete(ackMsg);
-                    if(sendack){
-                        seqNum--;
-                        seqNum += int(getParentModule()->par("WS"));
-                        seqNum %= int(getParentModule()->par("WS"));
-                    }
+        std::string payload = mmsg->getPayload();
+        // Only the awaited frame is checked, the core discards the others (or answers them with the same ACK) whatever they carry.
+        bool intact = mmsg->getSeqNum() != flow.rx.expected || static_cast<char>(Policy::Checksum::compute(payload)) == mmsg->getParity();
+        if(flow.rx.dataReceived(mmsg->getSeqNum(), intact, adapter, adapter)){
+            // Put the original message back together: without the flags and the escape characters of the byte stuffing.
+            for(int i=1; i+1<payload.size(); i++){
+                if(payload[i] == escape)
+                    i++;
+                flow.reassembly += payload[i];
+            }
+            // The line is delivered with its last fragment.
+            if(!mmsg->getMoreFragments()){
+                flow.deliveredBytes += flow.reassembly.size();
+                flow.lastDelivery = simTime();
+                if(estimating && steadyState.delivered(simTime().dbl(), flow.reassembly.size(), (simTime() - mmsg->getTimestamp()).dbl())){
+                    estimating = false;
+                    steadyEvent = getSimulation()->getEventNumber();
+                    steady = --steadyStateEstimators == 0;
                 }
+                flow.reassembly.clear();
+            }
         }
     }
-    cancelAndDelete(msg); // Release the resources of the message received.
+    cancelAndDelete(mmsg); // Release the resources of the message received.
+    if(steady)
+        endSimulation();
 }
 
-void Node::readInputFile(const char *filename)
+template<typename Policy>
+double ProtocolNode<Policy>::sendDataFrame(CoreAdapter& adapter, long j, int seqNumber)
 {
+    Flow& flow = adapter.flow;
+    double& newDelay = adapter.newDelay;
+    double& newTime = adapter.newTime;
+    double delays = adapter.delays;
+    if(flow.initial){// Add the starting time for the initial send.
+        newDelay += std::stod(adapter.msg->getPayload());
+        newTime += std::stod(adapter.msg->getPayload());
+        flow.initial = false;
+    }
+    // Perform byte stuffing on message, a binary input file has the stuffed payloads ready.
+    std::string value = flow.image ? std::string(flow.image->payload(j)) : byteStuffing(flow.messages[j]);
+    bool modificationE = false;
+    bool lossE = false;
+    bool duplicationE = false;
+    bool delayE = false;
+    // In case of timeout, send the first message in the window error free while the other messages with their errors.
+    if(!adapter.noErrors && nodeErrors){
+        std::string code = flow.errorCode(j);
+        if(code[0] == '1')
+            modificationE = true;
+        if(code[1] == '1')
+            lossE = true;
+        if(code[2] == '1')
+            duplicationE = true;
+        if(code[3] == '1')
+            delayE = true;
+    }
+    else
+        flow.clearErrorCode(j);
+    adapter.noErrors = false;
+    // Create a new message to send.
+    MessageFrame_Base *newMsg = new MessageFrame(value.c_str());
+    newMsg->setPayload(value);
+    newMsg->setSeqNum(seqNumber);
+    newMsg->setFlowId(adapter.msg->getFlowId());
+    newMsg->setMoreFragments(flow.image ? flow.image->moreFragments(j) : flow.moreFragments[j]);
+    // Add Parity/Trailer (the checksum of the node type).
+    unsigned char trailer = flow.image ? flow.image->trailer(j, typename Policy::Checksum()) : Policy::Checksum::compute(value);
+    newMsg->setParity(static_cast<char>(trailer));
+    newMsg->setFrameType(0); // i.e. data frame.
+    newMsg->setTimestamp(newTime); // The time it leaves the sender, for the delay of the steady-state estimates.
+    flow.sentFrames++;
+    newDelay += delays;
+    newTime += processingTime;
+    // Variable to ease printing logs
+    int duplicate = 0;
+    if(duplicationE)
+        duplicate = 1;
+    int modifiedBitNumber = 0;
+    std::string modifiedMsg;
+    // Handle loss, delay, modification and duplication channel errors.
+    if(!lossE){
+        if(modificationE){
+            modifiedMsg = newMsg->getPayload();
+            int randomI, randomBit;
+            if(counterRandom){
+                // The flow's transmission number tells the retransmissions of the frame apart.
+                randomI = int(counterStreams.uniform(0, modifiedMsg.size(), newMsg->getFlowId(), seqNumber, ERROR_BYTE_DRAW, flow.sentFrames));
+                randomBit = int(counterStreams.uniform(0, 8, newMsg->getFlowId(), seqNumber, ERROR_BIT_DRAW, flow.sentFrames));
+            }
+            else{
+                randomI = int(uniform(0,modifiedMsg.size()));
+                randomBit = int(uniform(0,8));
+            }
+            bits modifiedBits(modifiedMsg[randomI]);
+            modifiedBits[randomBit] = ~modifiedBits[randomBit];
+            modifiedMsg[randomI] = static_cast<char>( modifiedBits.to_ulong());
+            newMsg->setPayload(modifiedMsg);
+            newMsg->setName(modifiedMsg.c_str());
+            modifiedBitNumber = 8*randomI + randomBit;
+        }
+        if(delayE)
+            sendFrame(newMsg, newDelay + errorDelay);
+        else
+            sendFrame(newMsg, newDelay); // send out the message
+        if(delayE && duplicationE)
+            sendFrame(newMsg->dup(), newDelay + errorDelay + duplicationDelay);
+        else if(duplicationE)
+            sendFrame(newMsg->dup(), newDelay + duplicationDelay); // send out the message
+    }
+    else
+        cancelAndDelete(newMsg); // If the message was lost, clear its resources.
+    // Just some logging to the output file.
+    if(j > flow.logSeqNum){
+        if(!tracing()){
+            // Nobody reads the trace, skip building the line.
+        } else if(simTime().dbl() + newDelay - delays != simTime().dbl()){
+            // Write the output at its correct time.
+            writeOutputFileBP("output.txt", simTime().dbl() + newDelay - delays, flow.errorCode(j), false);
+            deferTraceLine(simTime().dbl() + newDelay - delays);
+        }
+        else
+            EV<<writeOutputFileBP("output.txt", simTime().dbl() + newDelay - delays, flow.errorCode(j));
+        flow.logSeqNum++;
+    }
+    if(tracing()){
+        const std::string& payload = modificationE && !lossE ? modifiedMsg : value;
+        double sentDelay = delayE ? int(errorDelay) : 0.0; // The trace has always shown ED in whole seconds.
+        double duplicateTime = newTime + duplicationDelay;
+        if(simTime().dbl() != newTime){
+            // Write the output at its correct time.
+            writeOutputFileBT("output.txt", newTime, flow.sender, "sent", seqNumber, payload, trailer, modifiedBitNumber, modificationE, lossE, duplicate, sentDelay, false);
+            deferTraceLine(newTime);
+            if(duplicationE){
+                writeOutputFileBT("output.txt", duplicateTime, flow.sender, "sent", seqNumber, payload, trailer, modifiedBitNumber, modificationE, lossE, duplicate+1, sentDelay, false);
+                deferTraceLine(duplicateTime);
+            }
+        } else {
+            EV<<writeOutputFileBT("output.txt", newTime, flow.sender, "sent", seqNumber, payload, trailer, modifiedBitNumber, modificationE, lossE, duplicate, sentDelay);
+            if(duplicationE)
+                EV<<writeOutputFileBT("output.txt", duplicateTime, flow.sender, "sent", seqNumber, payload, trailer, modifiedBitNumber, modificationE, lossE, duplicate+1, sentDelay);
+        }
+    }
+    // Start Timer by self messaging.
+    MessageFrame_Base *timerMsg = new MessageFrame("Timeout");
+    timerMsg->setSeqNum(seqNumber);
+    timerMsg->setFlowId(adapter.msg->getFlowId());
+    scheduleAt(newTime + timeoutInterval, timerMsg);
+    double sendTime = newTime;
+    newDelay -= transmissionDelay;
+    return sendTime;
+}
+
+template<typename Policy>
+void ProtocolNode<Policy>::sendControlFrame(CoreAdapter& adapter, int ackNum, bool nack, bool lost)
+{
+    MessageFrame_Base *ackMsg = new MessageFrame(nack ? "NACK" : "ACK");
+    ackMsg->setAckNum(ackNum);
+    ackMsg->setFlowId(adapter.msg->getFlowId());
+    ackMsg->setFrameType(nack ? 2 : 1);
+    // Check if the ACK/NACK was lost and log it accordingly in the output file.
+    if(!lost)
+        sendFrame(ackMsg, adapter.delays); // send out the message
+    else
+        cancelAndDelete(ackMsg);
+    if(tracing()){
+        writeOutputFileCF("output.txt", simTime().dbl() + processingTime, nack, ackNum, lost, false);
+        deferTraceLine(simTime().dbl() + processingTime);
+    }
+}
+
+template<typename Policy>
+void ProtocolNode<Policy>::deferTraceLine(double time)
+{
+    MessageFrame *logMsg;
+    if(traceLinePool.empty()){
+        logMsg = new MessageFrame("");
+        logMsg->setFrameType(-1);
+    } else {
+        logMsg = traceLinePool.back();
+        traceLinePool.pop_back();
+    }
+    logMsg->assignPayload(line.data(), line.size());
+    memoryAccount.addTraceBytes(line.size());
+    scheduleAt(time, logMsg);
+}
+
+template<typename Policy>
+void ProtocolNode<Policy>::sendFrame(MessageFrame_Base *frame, double delay)
+{
+    // Data frames carry their (stuffed) payload, control frames only the header.
+    if(frame->getFrameType() == 0)
+        frame->setByteLength(frame->getPayload().size() + FRAME_OVERHEAD);
+    else
+        frame->setByteLength(FRAME_OVERHEAD);
+    if(!linkMode){
+        if(train && frame->getFrameType() == 0)
+            train->add(simTime() + delay, frame);
+        else
+            sendDelayed(frame, delay, "nodeGate$o");
+        return;
+    }
+    // The link replaces TD: its serialization and propagation delays are added when the frame is transmitted.
+    delay -= transmissionDelay;
+    if(delay > 0){
+        frame->setKind(LINK_READY);
+        scheduleAt(simTime() + delay, frame);
+    } else {
+        flows[frame->getFlowId()].txQueue.insert(frame);
+        startTransmission();
+    }
+}
+
+template<typename Policy>
+void ProtocolNode<Policy>::startTransmission()
+{
+    cChannel *link = gate("nodeGate$o")->getTransmissionChannel();
+    if(linkFreeMsg->isScheduled() || link->getTransmissionFinishTime() > simTime())
+        return;
+    int id = nextFlow();
+    if(id < 0)
+        return;
+    Flow& flow = flows[id];
+    MessageFrame_Base *frame = check_and_cast<MessageFrame_Base *>(flow.txQueue.pop());
+    flow.deficit -= deficitRoundRobin ? frame->getByteLength() : 1;
+    send(frame, "nodeGate$o");
+    scheduleAt(link->getTransmissionFinishTime(), linkFreeMsg);
+}
+
+template<typename Policy>
+int ProtocolNode<Policy>::nextFlow()
+{
+    bool waiting = false;
+    for(auto& f : flows)
+        waiting = waiting || !f.second.txQueue.isEmpty();
+    if(!waiting)
+        return -1;
+    // A flow keeps its turn while its deficit covers its next frame: one frame with round robin, drrQuantum bytes with deficit round robin.
+    auto turn = flows.find(turnFlow);
+    for(;;){
+        if(turn != flows.end() && !turn->second.txQueue.isEmpty()){
+            long cost = deficitRoundRobin ? check_and_cast<cPacket *>(turn->second.txQueue.front())->getByteLength() : 1;
+            if(turn->second.deficit >= cost)
+                return turnFlow;
+        } else if(turn != flows.end())
+            turn->second.deficit = 0; // An idle flow doesn't save up its turns.
+        // Give the turn to the next flow.
+        turn = turn == flows.end() ? flows.begin() : std::next(turn);
+        if(turn == flows.end())
+            turn = flows.begin();
+        turnFlow = turn->first;
+        if(!turn->second.txQueue.isEmpty())
+            turn->second.deficit += deficitRoundRobin ? drrQuantum : 1;
+    }
+}
+
+template<typename Policy>
+void ProtocolNode<Policy>::finish()
+{
+    // What the flows the node sends cost: the frames sent beyond one per message were wasted on retransmissions.
+    long sentFrames = 0, wastedFrames = 0;
+    for(auto& f : flows)
+        if(f.second.sender){
+            sentFrames += f.second.sentFrames;
+            wastedFrames += f.second.sentFrames - std::min<long>(f.second.tx.next, f.second.messageCount());
+        }
+    if(sentFrames > 0){
+        recordScalar("sentFrames", sentFrames);
+        recordScalar("wastedFrames", wastedFrames);
+    }
+    // The totals of the flows the node receives, and with several of them each flow's share and how fair the shares were.
+    long deliveredBytes = 0;
+    simtime_t lastDelivery;
+    double sum = 0, sumOfSquares = 0;
+    int received = 0;
+    for(auto& f : flows){
+        const Flow& flow = f.second;
+        if(flow.sender || flow.deliveredBytes == 0)
+            continue;
+        double goodput = 8 * flow.deliveredBytes / (flow.lastDelivery - flow.launchTime).dbl();
+        deliveredBytes += flow.deliveredBytes;
+        lastDelivery = std::max(lastDelivery, flow.lastDelivery);
+        sum += goodput;
+        sumOfSquares += goodput * goodput;
+        received++;
+        if(flows.size() > 1)
+            recordScalar(("flow" + std::to_string(f.first) + ".goodput").c_str(), goodput);
+    }
+    if(deliveredBytes > 0){
+        recordScalar("deliveredBytes", deliveredBytes);
+        recordScalar("goodput", 8 * deliveredBytes / lastDelivery.dbl());
+    }
+    if(received > 1)
+        recordScalar("fairness", sum * sum / (received * sumOfSquares)); // Jain's fairness index of the flows' goodputs.
+    // The steady-state estimates, also when the input files ran out before they were steady.
+    if(estimating || steadyEvent >= 0){
+        recordScalar("steadyGoodput", steadyState.goodput.mean(), "bps");
+        recordScalar("steadyGoodputHalfWidth", steadyState.goodput.halfWidth(), "bps");
+        recordScalar("steadyDelay", steadyState.delay.mean(), "s");
+        recordScalar("steadyDelayHalfWidth", steadyState.delay.halfWidth(), "s");
+        recordScalar("steadyBatches", steadyState.goodput.batches());
+        recordScalar("steadyState", steadyEvent >= 0);
+        recordScalar("steadyEvents", steadyEvent >= 0 ? steadyEvent : getSimulation()->getEventNumber());
+    }
+}
+
+template<typename Policy>
+void ProtocolNode<Policy>::addCounters(ProtocolCounters& counters) const
+{
+    for(auto& f : flows){
+        const Flow& flow = f.second;
+        counters.deliveredBytes += flow.deliveredBytes;
+        if(!flow.sender)
+            continue;
+        // What was sent and is neither acknowledged nor in the window now was dropped and sent again.
+        counters.sentFrames += flow.sentFrames;
+        counters.retransmittedFrames += flow.sentFrames - flow.tx.next - flow.tx.window.size();
+        if(!flow.tx.done()){
+            counters.inFlight += flow.tx.window.size();
+            counters.windowLimit += flow.tx.sendWindow();
+        }
+    }
+}
+
+template<typename Policy>
+void ProtocolNode<Policy>::saveState(std::ostream& os)
+{
+    os << std::setprecision(17);
+    os << "index " << index << "\nturnFlow " << turnFlow << "\nflows " << flows.size() << "\n";
+    for(auto& f : flows){
+        os << "flow " << f.first << "\n";
+        saveFlowState(os, f.second);
+    }
+}
+
+template<typename Policy>
+void ProtocolNode<Policy>::saveFlowState(std::ostream& os, const Flow& flow)
+{
+    os << "sender " << flow.sender << "\ninitial " << flow.initial << "\n";
+    // The sender's window base and the receiver's awaited frame share the seqNum key.
+    os << "seqNum " << (flow.sender ? flow.tx.next : flow.rx.expected) << "\nseqBeg " << flow.tx.seqBeg << "\nstoppedTimeoutCount " << flow.tx.stoppedTimeouts << "\n";
+    os << "lastTime " << flow.lastTime << "\nlogSeqNum " << flow.logSeqNum << "\nlastNackSeqNum " << flow.tx.lastNack << "\n";
+    os << "congestionWindow " << flow.tx.congestionWindow << "\nsentFrames " << flow.sentFrames << "\nackLossDraws " << flow.ackLossDraws << "\n";
+    const InFlightWindow& window = flow.tx.window;
+    os << "window " << window.size();
+    for(long j=window.base(); j<window.base()+window.size(); j++)
+        os << " " << window[j].seqNum << " " << window[j].sendTime << " " << window[j].retransmits;
+    os << "\nreassembly ";
+    writeCheckpointString(os, flow.reassembly);
+    os << "\ndeliveredBytes " << flow.deliveredBytes << "\nlaunchTime " << flow.launchTime.raw() << "\nlastDelivery " << flow.lastDelivery.raw() << "\n";
+    // The messages are read again from the input file, only the error codes change while running.
+    os << "inputFile ";
+    writeCheckpointString(os, flow.inputFile);
+    os << "\nmessages " << flow.messageCount() << "\nerrors ";
+    std::string codes;
+    for(size_t j=0; j<flow.messageCount(); j++)
+        codes += flow.errorCode(j);
+    writeCheckpointString(os, codes);
+    os << "\n";
+}
+
+template<typename Policy>
+void ProtocolNode<Policy>::loadState(std::istream& is)
+{
+    index = readCheckpointValue<int>(is, "index");
+    turnFlow = readCheckpointValue<int>(is, "turnFlow");
+    size_t flowCount = readCheckpointValue<size_t>(is, "flows");
+    flows.clear();
+    for(size_t i=0; i<flowCount; i++)
+        loadFlowState(is, flows[readCheckpointValue<int>(is, "flow")]);
+}
+
+template<typename Policy>
+void ProtocolNode<Policy>::loadFlowState(std::istream& is, Flow& flow)
+{
+    flow.sender = readCheckpointValue<bool>(is, "sender");
+    flow.initial = readCheckpointValue<bool>(is, "initial");
+    long seqNum = readCheckpointValue<long>(is, "seqNum");
+    flow.tx.reset(seqSpace, windowSize, 0, adaptiveWindow); // The message count is known once the input file is read again.
+    flow.rx.reset(seqSpace, nodeErrors ? ackLossProbability : -1, useChannel);
+    if(flow.sender)
+        flow.tx.next = seqNum;
+    else
+        flow.rx.expected = seqNum;
+    flow.tx.seqBeg = readCheckpointValue<int>(is, "seqBeg");
+    flow.tx.stoppedTimeouts = readCheckpointValue<int>(is, "stoppedTimeoutCount");
+    flow.lastTime = readCheckpointValue<double>(is, "lastTime");
+    flow.logSeqNum = readCheckpointValue<int>(is, "logSeqNum");
+    flow.tx.lastNack = readCheckpointValue<long>(is, "lastNackSeqNum");
+    flow.tx.congestionWindow = readCheckpointValue<double>(is, "congestionWindow");
+    flow.sentFrames = readCheckpointValue<long>(is, "sentFrames");
+    flow.ackLossDraws = readCheckpointValue<long>(is, "ackLossDraws");
+    int inFlight = readCheckpointValue<int>(is, "window");
+    flow.tx.window.reset(windowSize, flow.tx.next);
+    for(int i=0; i<inFlight; i++){
+        int seqNumber, retransmits;
+        double sendTime;
+        is >> seqNumber >> sendTime >> retransmits;
+        flow.tx.window.push(flow.tx.next + i, seqNumber, sendTime).retransmits = retransmits;
+    }
+    readCheckpointKey(is, "reassembly");
+    flow.reassembly = readCheckpointString(is);
+    flow.deliveredBytes = readCheckpointValue<long>(is, "deliveredBytes");
+    flow.launchTime = SimTime::fromRaw(readCheckpointValue<int64_t>(is, "launchTime"));
+    flow.lastDelivery = SimTime::fromRaw(readCheckpointValue<int64_t>(is, "lastDelivery"));
+    readCheckpointKey(is, "inputFile");
+    flow.inputFile = readCheckpointString(is);
+    size_t messageCount = readCheckpointValue<size_t>(is, "messages");
+    readCheckpointKey(is, "errors");
+    std::string codes = readCheckpointString(is);
+    flow.messages.clear();
+    flow.errors.clear();
+    flow.moreFragments.clear();
+    flow.image.reset();
+    flow.errorsCleared.clear();
+    memoryAccount.addInputBytes(-flow.inputBytes);
+    flow.inputBytes = 0;
+    if(flow.sender){
+        readInputFile(flow.inputFile.c_str(), flow);
+        if(flow.messageCount() != messageCount || codes.size() != 4*messageCount)
+            throw cRuntimeError("The checkpoint was taken with a different '%s'", flow.inputFile.c_str());
+        for(size_t i=0; i<messageCount; i++){
+            std::string code = codes.substr(4*i, 4);
+            if(!flow.image)
+                flow.errors[i] = code;
+            else if(code != flow.image->errorCode(i)){
+                // The codes of an image only change by being cleared.
+                if(code != "0000")
+                    throw cRuntimeError("The checkpoint was taken with a different '%s'", flow.inputFile.c_str());
+                flow.errorsCleared[i] = true;
+            }
+        }
+        flow.tx.messageCount = messageCount;
+    }
+}
+
+template<typename Policy>
+void ProtocolNode<Policy>::restoreEvent(MessageFrame_Base *msg, simtime_t arrivalTime, bool selfMessage)
+{
+    Enter_Method_Silent();
+    take(msg);
+    if(msg->getFrameType() == -1)
+        memoryAccount.addTraceBytes(msg->getPayload().size()); // A deferred trace line, written when it comes back.
+    if(selfMessage)
+        scheduleAt(arrivalTime, msg);
+    else
+        sendDelayed(msg, arrivalTime - simTime(), "nodeGate$o"); // The fixed delay model adds nothing on the way.
+}
+
+template<typename Policy>
+void ProtocolNode<Policy>::readInputFile(const char *filename, Flow& flow)
+{
+    // A binary input file (see frameimage.h) is mapped as it is, the error codes included: the cleared ones are marked aside.
+    if(FrameImage::isImage(filename)){
+        flow.image.reset(new FrameImage(filename));
+        if(flow.image->mtu() != mtu)
+            throw cRuntimeError("'%s' was converted for an mtu of %ld bytes, the run uses %ld", filename, flow.image->mtu(), mtu);
+        flow.errorsCleared.assign(flow.image->count(), false);
+        flow.inputBytes += flow.image->size() + (flow.image->count() + 7) / 8;
+        memoryAccount.addInputBytes(flow.image->size() + (flow.image->count() + 7) / 8);
+        return;
+    }
     std::ifstream filestream;
     std::string line;
 
@@ -377,9 +918,18 @@ void Node::readInputFile(const char *filename)
             }
             else {
                 std::string err = line.substr(0,4);
-                errors.push_back(err);
                 std::string mes = line.substr(5);
-                messages.push_back(mes);
+                // With an MTU a line whose frame would be longer is split into fragments, the error code goes with the first one.
+                size_t start = 0;
+                do {
+                    size_t end = fragmentEnd(mes, start, mtu);
+                    flow.errors.push_back(start == 0 ? err : "0000");
+                    flow.messages.push_back(mes.substr(start, end - start));
+                    flow.moreFragments.push_back(end < mes.size());
+                    flow.inputBytes += flow.messages.back().size() + flow.errors.back().size();
+                    memoryAccount.addInputBytes(flow.messages.back().size() + flow.errors.back().size());
+                    start = end;
+                } while(start < mes.size());
             }
         }
     }
@@ -387,129 +937,90 @@ void Node::readInputFile(const char *filename)
     return;
 }
 
-std::string Node::byteStuffing(int seqNumber){
-    std::string s = "$";
-    for(int i=0; i<messages[seqNumber].size(); i++)
-    {
-        if(messages[seqNumber][i] == flag || messages[seqNumber][i] == escape)
-        {
-            s += escape;
-        }
-        s += messages[seqNumber][i];
-    }
-    s += flag;
-    return s;
+template<typename Policy>
+std::string ProtocolNode<Policy>::byteStuffing(const std::string& message){
+    return stuffFrame(message); // Shared with the converter of the binary input files.
 }
 
-void Node::writeOutputFile(const char *filename, std::string logMessage){
-    std::ofstream filestream;
-    filestream.open(filename, std::ios_base::app);
-    if(!filestream) {
-        throw cRuntimeError("Error opening file '%s'?", filename);
-    } else {
-        filestream.write(logMessage.c_str(), logMessage.size());
+template<typename Policy>
+void ProtocolNode<Policy>::writeOutputFile(const char *filename, const char *data, size_t size){
+    // With the async or gzip traceWriter the Coordinator opened the background writer, which keeps the lines of all the nodes in order.
+    if(traceWriter.isOpen()){
+        traceWriter.write(data, size);
+        return;
     }
-    filestream.close();
-    return;
+    // Kept open for the whole run: every line is flushed right away so the lines of both nodes stay in order.
+    if(!outputStream.is_open()) {
+        outputStream.open(filename, std::ios_base::app);
+        if(!outputStream)
+            throw cRuntimeError("Error opening file '%s'?", filename);
+    }
+    outputStream.write(data, size);
+    outputStream.flush();
 }
 
 // At time [.. starting processing time.. ], Node[id] , Introducing channel error with code=[ code in 4 bits ] .
-std::string Node::writeOutputFileBP(const char *filename, double startingPT, int j, bool write)
+template<typename Policy>
+const LogLine& ProtocolNode<Policy>::writeOutputFileBP(const char *filename, double startingPT, const std::string& code, bool write)
 {
-    std::ofstream filestream;
-    std::string line = "At time ["+std::to_string(int(startingPT));
-    if(int((startingPT-int(startingPT))*10) != 0)
-        line += "."+std::to_string(int((startingPT-int(startingPT))*10));
-    line += "], Node["+std::to_string(index)+"] , Introducing channel error with code =["+errors[j]+"]\n";
-    filestream.open(filename, std::ios_base::app);
-    if(!filestream) {
-        throw cRuntimeError("Error opening file '%s'?", filename);
-    } else {
-        if(write)
-            filestream.write(line.c_str(), line.size());
-    }
-    filestream.close();
+    line.clear() << "At time [";
+    line.time(startingPT) << "], Node[" << index << "] , Introducing channel error with code =[" << code << "]\n";
+    if(write && traceFile)
+        writeOutputFile(filename, line.data(), line.size());
     return line;
 }
 
 //At time [.. starting sending time after processing.. ], Node[id] [sent/received] frame with seq_num=[..] and payload=[ .. in characters after modification.. ] and trailer=[.in bits.. ] ,
 //Modified [-1 for no modification, otherwise the modified bit number] ,Lost [Yes/No], Duplicate [0 for none, 1 for the first version, 2 for the second version], Delay [0 for no delay , otherwise the error delay interval].
-std::string Node::writeOutputFileBT(const char *filename, double startingTR, std::string verb, int seqNumber, std::string payload, std::string trailer, int modified, bool mod, bool lost, int duplicate, double delay, bool write){
-    std::ofstream filestream;
-    std::string line = "At time ["+std::to_string(int(startingTR));
-    if(int((startingTR-int(startingTR))*10) != 0)
-        line += "."+std::to_string(int((startingTR-int(startingTR))*10));
-    line += "], Node["+std::to_string(index)+"] ["+verb+"] frame with ";
-    line += "seq_num=["+std::to_string(seqNumber)+"] and payload=["+payload+"] and trailer=["+trailer+"] , Modified [";
+template<typename Policy>
+const LogLine& ProtocolNode<Policy>::writeOutputFileBT(const char *filename, double startingTR, bool sender, const char *verb, int seqNumber, const std::string& payload, unsigned char trailer, int modified, bool mod, bool lost, int duplicate, double delay, bool write){
+    line.clear() << "At time [";
+    line.time(startingTR) << "], Node[" << index << "] [" << verb << "] frame with ";
+    line << "seq_num=[" << seqNumber << "] and payload=[" << payload << "] and trailer=[";
+    line.trailer(trailer) << "] , Modified [";
     if(!mod)
-        line +="-1";
-    else
-        line += std::to_string(modified);
-    line +="] ,Lost [";
-    if(lost)
-        line+= "Yes";
+        line << "-1";
     else
-        line+= "No";
+        line << modified;
+    line << "] ,Lost [" << (lost ? "Yes" : "No");
     if(sender){
-        line += "], Duplicate ["+std::to_string(duplicate)+"], Delay ["+std::to_string(int(delay));
-        if(int((delay-int(delay))*10) != 0)
-            line += "."+std::to_string(int((delay-int(delay))*10));
-        line += "]\n";
+        line << "], Duplicate [" << duplicate << "], Delay [";
+        line.time(delay) << "]\n";
     }
     else
-        line += "]\n";
-    filestream.open(filename, std::ios_base::app);
-    if(!filestream) {
-        throw cRuntimeError("Error opening file '%s'?", filename);
-    } else {
-        if(write)
-            filestream.write(line.c_str(), line.size());
-    }
-    filestream.close();
+        line << "]\n";
+    if(write && traceFile)
+        writeOutputFile(filename, line.data(), line.size());
     return line;
 }
 
 //Time out event at time [.. timer off-time.. ], at Node[id] for frame with seq_num=[..]
-std::string Node::writeOutputFileTO(const char *filename, double timeoutTime, int seqNumber, bool write){
-    std::ofstream filestream;
-    std::string line = "Time out event at time ["+std::to_string(int(timeoutTime));
-    if(int((timeoutTime-int(timeoutTime))*10) != 0)
-        line += "."+std::to_string(int((timeoutTime-int(timeoutTime))*10));
-    line += "], at Node["+std::to_string(index)+"] for frame with seq_num=["+std::to_string(seqNumber)+"]\n";
-    filestream.open(filename, std::ios_base::app);
-    if(!filestream) {
-        throw cRuntimeError("Error opening file '%s'?", filename);
-    } else {
-        if(write)
-            filestream.write(line.c_str(), line.size());
-    }
-    filestream.close();
+template<typename Policy>
+const LogLine& ProtocolNode<Policy>::writeOutputFileTO(const char *filename, double timeoutTime, int seqNumber, bool write){
+    line.clear() << "Time out event at time [";
+    line.time(timeoutTime) << "], at Node[" << index << "] for frame with seq_num=[" << seqNumber << "]\n";
+    if(write && traceFile)
+        writeOutputFile(filename, line.data(), line.size());
+    return line;
+}
+
+// Fast retransmit event at time [.. NACK received time ..], at Node[id] for frame with seq_num=[..]
+template<typename Policy>
+const LogLine& ProtocolNode<Policy>::writeOutputFileFR(const char *filename, double nackTime, int seqNumber, bool write){
+    line.clear() << "Fast retransmit event at time [";
+    line.time(nackTime) << "], at Node[" << index << "] for frame with seq_num=[" << seqNumber << "]\n";
+    if(write && traceFile)
+        writeOutputFile(filename, line.data(), line.size());
     return line;
 }
 
 //At time[.. starting sending time after processing.. ], Node[id] Sending [ACK/NACK] with number [] , loss [Yes/No ]
-std::string Node::writeOutputFileCF(const char *filename, double startingTR, bool nack, int ackNum, bool loss, bool write){
-    std::ofstream filestream;
-    std::string line = "At time ["+std::to_string(int(startingTR));
-    if(int((startingTR-int(startingTR))*10) != 0)
-        line += "."+std::to_string(int((startingTR-int(startingTR))*10));
-    line += "], Node["+std::to_string(index)+"] Sending [";
-    if(nack)
-        line += "NACK";
-    else
-        line += "ACK";
-    line += "] with number ["+std::to_string(ackNum)+"] , loss [";
-    if(loss)
-        line += "Yes]\n";
-    else
-        line += "No]\n";
-    filestream.open(filename, std::ios_base::app);
-    if(!filestream) {
-        throw cRuntimeError("Error opening file '%s'?", filename);
-    } else {
-        if(write)
-            filestream.write(line.c_str(), line.size());
-    }
-    filestream.close();
+template<typename Policy>
+const LogLine& ProtocolNode<Policy>::writeOutputFileCF(const char *filename, double startingTR, bool nack, int ackNum, bool loss, bool write){
+    line.clear() << "At time [";
+    line.time(startingTR) << "], Node[" << index << "] Sending [" << (nack ? "NACK" : "ACK");
+    line << "] with number [" << ackNum << "] , loss [" << (loss ? "Yes]\n" : "No]\n");
+    if(write && traceFile)
+        writeOutputFile(filename, line.data(), line.size());
     return line;
 }
@@ -0,0 +1,141 @@
+/*
+ * noisychannel.cc
+ *
+ *  Stochastic channel error models between the nodes.
+ *
+ */
+#include <string>
+#include <cmath>
+#include <omnetpp.h>
+#include "MessageFrame_m.h"
+
+using namespace omnetpp;
+
+// Local RNG indices of the error models, map them to separate streams with **.channel.rng-N in the ini file.
+#define BIT_ERROR_RNG 0
+#define BURST_LOSS_RNG 1
+#define REORDER_RNG 2
+#define DUPLICATE_RNG 3
+
+/**
+ * Derive the NoisyChannel class from cSimpleModule. The NoisyChannel sits between the two nodes and forwards every frame
+ * to the other side after applying its error models, so the nodes only deal with the protocol.
+ * The models are pluggable through the "model" parameter: "none", "ber" (independent bit errors with probability ber)
+ * or "gilbert" (Gilbert-Elliott bursty loss with a good and a bad state). Reordering and duplication can be added on top of any of them.
+ * Every model draws from its own RNG stream so enabling one does not change the draws of the others.
+ * Bit errors flip the payload (or trailer) bits of data frames so the receiver detects them through the parity,
+ * while control frames with bit errors are only flagged and dropped by the node.
+ */
+class NoisyChannel : public cSimpleModule
+{
+  protected:
+    /// Data members
+    std::string model; // Used to choose the loss/corruption model.
+    bool badState[2] = {false, false}; // Used to keep the Gilbert-Elliott state of each direction.
+    // Used to record what the channel did to the frames.
+    long framesIn = 0, framesLost = 0, framesCorrupted = 0, framesReordered = 0, framesDuplicated = 0;
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+    // Used to flip bits of the frame according to the bit error rate. Returns whether any bit was flipped.
+    bool applyBitErrors(MessageFrame_Base *frame);
+    // Used to step the Gilbert-Elliott chain of a direction. Returns whether the frame is lost.
+    bool applyBurstLoss(int direction);
+};
+
+// The module class needs to be registered with OMNeT++
+Define_Module(NoisyChannel);
+
+void NoisyChannel::initialize()
+{
+    model = par("model").stdstringValue();
+    if(model != "none" && model != "ber" && model != "gilbert")
+        throw cRuntimeError("Unknown channel model '%s', use none, ber or gilbert", model.c_str());
+    // The geometric gaps between bit errors take the log of 1 - ber, and any other probability out of range is meaningless too.
+    for(const char *name : {"ber", "pGoodToBad", "pBadToGood", "lossGood", "lossBad", "reorderProbability", "duplicateProbability"}){
+        double probability = par(name);
+        if(!(probability >= 0 && probability <= 1))
+            throw cRuntimeError("A %s of %g is not a probability, use 0 to 1", name, probability);
+    }
+}
+
+void NoisyChannel::handleMessage(cMessage *msg)
+{
+    MessageFrame_Base *frame = check_and_cast<MessageFrame_Base *> (msg);
+    // Each direction is forwarded out of the opposite port.
+    int direction = frame->arrivedOn("port0$i") ? 0 : 1;
+    const char *outGate = direction == 0 ? "port1$o" : "port0$o";
+    framesIn++;
+    if(model == "gilbert" && applyBurstLoss(direction)){
+        framesLost++;
+        delete frame;
+        return;
+    }
+    if(model == "ber" && applyBitErrors(frame))
+        framesCorrupted++;
+    double delay = 0;
+    double reorderProbability = par("reorderProbability");
+    double duplicateProbability = par("duplicateProbability");
+    // Only draw when the model is enabled, so its RNG stream does not have to be configured otherwise.
+    if(reorderProbability > 0 && uniform(0, 1, REORDER_RNG) < reorderProbability){
+        // Hold the frame back so the frames behind it overtake it.
+        delay = par("reorderDelay");
+        framesReordered++;
+    }
+    if(duplicateProbability > 0 && uniform(0, 1, DUPLICATE_RNG) < duplicateProbability){
+        sendDelayed(frame->dup(), delay + double(par("duplicateDelay")), outGate);
+        framesDuplicated++;
+    }
+    sendDelayed(frame, delay, outGate);
+}
+
+bool NoisyChannel::applyBitErrors(MessageFrame_Base *frame)
+{
+    double ber = par("ber");
+    if(ber <= 0)
+        return false;
+    std::string payload = frame->getPayload();
+    unsigned char parity = frame->getParity();
+    long payloadBits = frame->getFrameType() == 0 ? 8 * long(payload.size()) : 0;
+    long totalBits = frame->getBitLength();
+    bool flipped = false;
+    // Jump straight from one error to the next: the gaps between bit errors are geometrically distributed.
+    for(long pos = -1;;){
+        pos += 1 + long(std::floor(std::log(1 - uniform(0, 1, BIT_ERROR_RNG)) / std::log(1 - ber)));
+        if(pos >= totalBits)
+            break;
+        flipped = true;
+        if(pos < payloadBits)
+            payload[pos / 8] ^= char(1 << (pos % 8));
+        else
+            parity ^= (1 << (pos % 8));
+    }
+    if(flipped){
+        frame->setBitError(true);
+        if(frame->getFrameType() == 0){
+            frame->setPayload(payload);
+            frame->setParity(char(parity));
+        }
+    }
+    return flipped;
+}
+
+bool NoisyChannel::applyBurstLoss(int direction)
+{
+    // Move between the good and the bad state, then lose the frame with the loss probability of the new state.
+    if(badState[direction])
+        badState[direction] = uniform(0, 1, BURST_LOSS_RNG) >= double(par("pBadToGood"));
+    else
+        badState[direction] = uniform(0, 1, BURST_LOSS_RNG) < double(par("pGoodToBad"));
+    double lossProbability = badState[direction] ? double(par("lossBad")) : double(par("lossGood"));
+    return uniform(0, 1, BURST_LOSS_RNG) < lossProbability;
+}
+
+void NoisyChannel::finish()
+{
+    recordScalar("framesIn", framesIn);
+    recordScalar("framesLost", framesLost);
+    recordScalar("framesCorrupted", framesCorrupted);
+    recordScalar("framesReordered", framesReordered);
+    recordScalar("framesDuplicated", framesDuplicated);
+}
@@ -0,0 +1,84 @@
+/*
+ * seqnum.h
+ *
+ *  Sequence-number space of the Go Back N frames.
+ *
+ */
+#ifndef SEQNUM_H_
+#define SEQNUM_H_
+
+#include <stdexcept>
+#include <string>
+
+/**
+ * The sequence-number space used by the sender and the receiver. Sequence numbers are n-bit serial numbers
+ * (RFC 1982 style) so the window size is decoupled from the numbering: any window up to 2^n - 1 frames is
+ * unambiguous for Go Back N. With n = 0 the legacy numbering modulo the window size is kept.
+ * All the helpers only use masking when the space is a power of two, which is always the case for n > 0.
+ * It doesn't depend on the simulator (see gbn.h), a bad configuration throws std::invalid_argument.
+ */
+class SeqSpace
+{
+  public:
+    SeqSpace() {}
+    SeqSpace(int bits, int windowSize)
+    {
+        if(bits < 0 || bits > 30)
+            throw std::invalid_argument("Sequence numbers must be 0 to 30 bits wide, got " + std::to_string(bits));
+        if(windowSize < 1)
+            throw std::invalid_argument("Window size must be at least 1, got " + std::to_string(windowSize));
+        if(bits == 0) {
+            modulus = windowSize;
+        } else {
+            modulus = 1 << bits;
+            // Go Back N needs one spare number to tell a new window from a retransmitted one.
+            if(windowSize > modulus - 1)
+                throw std::invalid_argument("Window size " + std::to_string(windowSize) + " is too large for " + std::to_string(bits)
+                        + "-bit sequence numbers (at most " + std::to_string(modulus - 1) + ")");
+        }
+        mask = (modulus & (modulus - 1)) == 0 ? modulus - 1 : -1;
+    }
+    int size() const { return modulus; }
+    // Wraps any integer (e.g. a frame index) into the space.
+    int wrap(long long n) const { return mask >= 0 ? int(n & mask) : int(((n % modulus) + modulus) % modulus); }
+    // Sequence number n steps after s.
+    int add(int s, int n) const { return wrap((long long)s + n); }
+    // Number of steps from b forward to a, in [0, size).
+    int diff(int a, int b) const { return wrap((long long)a - b); }
+    // Whether s lies in the window of 'count' numbers starting at base.
+    bool inWindow(int s, int base, int count) const { return diff(s, base) < count; }
+
+  private:
+    int modulus = 1;
+    int mask = 0;
+};
+
+/**
+ * A sequence-number space whose width is fixed at compile time, with the interface of SeqSpace.
+ * Wrapping is a constant mask, so the node types built on it have no modulus to load and no branch to take.
+ */
+template<int Bits>
+class FixedSeqSpace
+{
+    static_assert(Bits > 0 && Bits <= 30, "Sequence numbers must be 1 to 30 bits wide");
+  public:
+    static constexpr int modulus = 1 << Bits;
+    static constexpr int mask = modulus - 1;
+    FixedSeqSpace() {}
+    FixedSeqSpace(int bits, int windowSize)
+    {
+        if(bits != Bits)
+            throw std::invalid_argument("This node type is built for " + std::to_string(Bits) + "-bit sequence numbers, set seqNumBits to "
+                    + std::to_string(Bits) + " (got " + std::to_string(bits) + ")");
+        if(windowSize < 1 || windowSize > modulus - 1)
+            throw std::invalid_argument("Window size " + std::to_string(windowSize) + " is out of range for " + std::to_string(Bits)
+                    + "-bit sequence numbers (1 to " + std::to_string(modulus - 1) + ")");
+    }
+    int size() const { return modulus; }
+    int wrap(long long n) const { return int(n & mask); }
+    int add(int s, int n) const { return wrap((long long)s + n); }
+    int diff(int a, int b) const { return wrap((long long)a - b); }
+    bool inWindow(int s, int base, int count) const { return diff(s, base) < count; }
+};
+
+#endif /* SEQNUM_H_ */
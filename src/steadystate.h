@@ -0,0 +1,120 @@
+/*
+ * steadystate.h
+ *
+ *  Batch means estimates of the steady state, to end a run once they are precise enough.
+ *
+ */
+#ifndef STEADYSTATE_H_
+#define STEADYSTATE_H_
+
+#include <cmath>
+#include <limits>
+
+/**
+ * The batch means estimate of a steady-state mean: the observations are grouped in batches of a fixed size, and the means
+ * of the batches, nearly independent once the batches are long enough, give the estimate and its confidence interval.
+ * The first batch is dropped as the warm-up.
+ */
+class BatchMeans
+{
+  public:
+    void reset()
+    {
+        warm = false;
+        n = 0;
+        mean_ = 0;
+        squares = 0;
+    }
+    void addBatch(double value)
+    {
+        if(!warm){
+            warm = true;
+            return;
+        }
+        // Welford's update, the batch means can be large and close to each other.
+        n++;
+        double delta = value - mean_;
+        mean_ += delta / n;
+        squares += delta * (value - mean_);
+    }
+    long batches() const { return n; }
+    double mean() const { return mean_; }
+    // Half the width of the 95% confidence interval of the mean, infinite below two batches.
+    double halfWidth() const
+    {
+        if(n < 2)
+            return std::numeric_limits<double>::infinity();
+        return studentT95(n - 1) * std::sqrt(squares / (n - 1) / n);
+    }
+    // The half width relative to the estimate.
+    double relativePrecision() const { return mean_ != 0 ? halfWidth() / std::fabs(mean_) : std::numeric_limits<double>::infinity(); }
+
+  private:
+    bool warm = false; // Whether the warm-up batch is over.
+    long n = 0;
+    double mean_ = 0;
+    double squares = 0; // Sum of the squared deviations from the mean.
+    // The two-sided 95% quantile of Student's t with 'freedom' degrees of freedom (Cornish-Fisher, within 0.1% from 5 on).
+    static double studentT95(long freedom)
+    {
+        const double z = 1.959964;
+        double v = freedom, z3 = z * z * z, z5 = z3 * z * z, z7 = z5 * z * z;
+        return z + (z3 + z) / 4 / v + (5 * z5 + 16 * z3 + 3 * z) / 96 / (v * v) + (3 * z7 + 19 * z5 + 17 * z3 - 15 * z) / 384 / (v * v * v);
+    }
+};
+
+/**
+ * The steady-state goodput and delay of what a receiver delivers. Every batchSize delivered lines make a batch: its goodput
+ * is the bits delivered over the time since the previous batch, its delay the mean delay of the lines. The estimates are
+ * steady once both have at least minBatches batches and a relative precision of at most 'precision'.
+ */
+struct SteadyStateDetector
+{
+    static constexpr long minBatches = 10;
+    BatchMeans goodput; // Bits per second.
+    BatchMeans delay; // Seconds from when a frame leaves the sender to when its line is delivered.
+    double precision = 0;
+    long batchSize = 1;
+    long deliveries = 0; // Lines of the batch being filled.
+    double bytes = 0; // Bytes of the batch being filled.
+    double delaySum = 0; // Delays of the batch being filled.
+    double batchStart = 0; // Time the batch being filled started at.
+
+    void reset(double relativePrecision, long size, double now)
+    {
+        goodput.reset();
+        delay.reset();
+        precision = relativePrecision;
+        batchSize = size;
+        deliveries = 0;
+        bytes = 0;
+        delaySum = 0;
+        batchStart = now;
+    }
+    bool steady() const
+    {
+        return goodput.batches() >= minBatches && goodput.relativePrecision() <= precision && delay.relativePrecision() <= precision;
+    }
+    // Used when a line of 'lineBytes' is delivered at 'now' after 'lineDelay'. Returns whether the estimates became steady.
+    bool delivered(double now, long lineBytes, double lineDelay)
+    {
+        deliveries++;
+        bytes += lineBytes;
+        delaySum += lineDelay;
+        if(deliveries < batchSize || now <= batchStart)
+            return false;
+        goodput.addBatch(8 * bytes / (now - batchStart));
+        delay.addBatch(delaySum / deliveries);
+        deliveries = 0;
+        bytes = 0;
+        delaySum = 0;
+        batchStart = now;
+        return steady();
+    }
+};
+
+// The receiving nodes of the schedule whose estimates are not steady yet, counted by the Coordinator at initialization:
+// the run ends once the last of them is.
+inline int steadyStateEstimators = 0;
+
+#endif /* STEADYSTATE_H_ */
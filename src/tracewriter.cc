@@ -0,0 +1,78 @@
+/*
+ * tracewriter.cc
+ *
+ *  The background thread writing the trace.
+ *
+ */
+#include "tracewriter.h"
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <zlib.h>
+
+void TraceWriter::open(const std::string& filename, bool gzip)
+{
+    close();
+    // gzip at its fastest level, so the thread keeps up with the simulation.
+    void *file = gzip ? (void *)gzopen(filename.c_str(), "wb1") : (void *)std::fopen(filename.c_str(), "wb");
+    if(!file)
+        throw std::runtime_error("Error opening file '" + filename + "'?");
+    for(Buffer& buffer : buffers){
+        if(!buffer.data)
+            buffer.data.reset(new char[bufferSize]);
+        buffer.used = 0;
+        buffer.state.store(FREE);
+    }
+    filling = 0;
+    error.clear();
+    closing.store(false);
+    running = true;
+    thread = std::thread(&TraceWriter::run, this, file, gzip);
+}
+
+void TraceWriter::close()
+{
+    if(!running)
+        return;
+    if(buffers[filling].used > 0)
+        handOver();
+    closing.store(true, std::memory_order_release);
+    thread.join();
+    running = false;
+    if(!error.empty())
+        throw std::runtime_error(error);
+}
+
+void TraceWriter::handOver()
+{
+    buffers[filling].state.store(FULL, std::memory_order_release);
+    filling = (filling + 1) % bufferCount;
+    // The thread is still writing the buffer that comes next: wait for it.
+    while(buffers[filling].state.load(std::memory_order_acquire) != FREE)
+        std::this_thread::yield();
+}
+
+void TraceWriter::run(void *file, bool gzip)
+{
+    int writing = 0;
+    for(;;){
+        Buffer& buffer = buffers[writing];
+        if(buffer.state.load(std::memory_order_acquire) == FULL){
+            bool written = gzip ? gzwrite((gzFile)file, buffer.data.get(), buffer.used) == int(buffer.used)
+                    : std::fwrite(buffer.data.get(), 1, buffer.used, (FILE *)file) == buffer.used;
+            if(!written && error.empty())
+                error = "Error writing the trace";
+            buffer.used = 0;
+            buffer.state.store(FREE, std::memory_order_release);
+            writing = (writing + 1) % bufferCount;
+        } else if(closing.load(std::memory_order_acquire)){
+            // Closing is set after the last buffer was handed over, so an empty one here means everything is written.
+            if(buffer.state.load(std::memory_order_acquire) != FULL)
+                break;
+        } else
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    bool closed = gzip ? gzclose((gzFile)file) == Z_OK : std::fclose((FILE *)file) == 0;
+    if(!closed && error.empty())
+        error = "Error writing the trace";
+}
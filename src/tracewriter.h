@@ -0,0 +1,74 @@
+/*
+ * tracewriter.h
+ *
+ *  Writing the trace on a background thread.
+ *
+ */
+#ifndef TRACEWRITER_H_
+#define TRACEWRITER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+/**
+ * The trace file written by a background thread, optionally gzip compressed. The simulation fills a buffer and hands
+ * it over when full; the thread writes (and compresses) it while the simulation fills the next one. The buffers form a
+ * ring of three whose handoff is an atomic state per buffer, so neither side ever takes a lock: the simulation only
+ * waits when the thread is two buffers behind, the thread polls for the next full buffer.
+ * The lines of all the nodes go through the one writer of the process in the order they are written, as with the
+ * direct writes. A gzip trace is a standard gzip stream, "zcat output.txt.gz" gives the plain output.txt.
+ * The Coordinator opens it at the start of a run and closes it at the end; failures throw std::runtime_error.
+ */
+class TraceWriter
+{
+  public:
+    ~TraceWriter()
+    {
+        try { close(); } catch(const std::exception&) {} // Nobody is left to report a failure to at exit.
+    }
+    // Starts a new trace file (truncating it), compressed with gzip or plain.
+    void open(const std::string& filename, bool gzip);
+    // Hands over what is buffered, waits until it is all written and closes the file.
+    void close();
+    bool isOpen() const { return running; }
+    void write(const char *data, size_t size)
+    {
+        while(size > 0){
+            Buffer& buffer = buffers[filling];
+            size_t n = std::min(size, bufferSize - buffer.used);
+            std::copy(data, data + n, buffer.data.get() + buffer.used);
+            buffer.used += n;
+            data += n;
+            size -= n;
+            if(buffer.used == bufferSize)
+                handOver();
+        }
+    }
+
+  private:
+    enum State { FREE, FULL };
+    static constexpr int bufferCount = 3;
+    static constexpr size_t bufferSize = 1 << 20;
+    struct Buffer
+    {
+        std::unique_ptr<char[]> data;
+        size_t used = 0;
+        std::atomic<int> state{FREE};
+    };
+    Buffer buffers[bufferCount];
+    int filling = 0; // The buffer the simulation fills.
+    bool running = false;
+    std::atomic<bool> closing{false};
+    std::thread thread;
+    std::string error; // Set by the thread when it fails to write, reported by close().
+    void handOver();
+    void run(void *file, bool gzip);
+};
+inline TraceWriter traceWriter;
+
+#endif /* TRACEWRITER_H_ */
@@ -0,0 +1,80 @@
+/*
+ * window.h
+ *
+ *  The frames of the sender window that are in flight.
+ *
+ */
+#ifndef WINDOW_H_
+#define WINDOW_H_
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * What the sender keeps about a frame it sent that is not acknowledged yet.
+ */
+struct InFlightFrame
+{
+    long index = -1; // Index of the message in the input file, i.e. the unwrapped sequence number.
+    int seqNum = 0; // Sequence number the frame was sent with.
+    double sendTime = 0; // Time the frame left the node after processing.
+    int retransmits = 0; // Number of times the same message was sent before.
+};
+
+/**
+ * The in-flight frames of a sender window in a fixed-capacity ring buffer, oldest first from the window base.
+ * Sliding the window and dropping the whole window (on a timeout) are O(1), and a frame is found directly from its message index:
+ * the capacity is a power of two at least as large as the window, so the slot of a frame is its index masked.
+ * Dropped slots keep their contents, which is how a frame sent again knows how many times it was retransmitted.
+ * Like the rest of the protocol core (gbn.h) it doesn't depend on the simulator: misuse throws std::logic_error.
+ */
+class InFlightWindow
+{
+  public:
+    // Empties the window for up to windowSize frames, the next frame to be sent being message 'base'.
+    void reset(int windowSize, long base = 0)
+    {
+        size_t capacity = 1;
+        while(capacity < size_t(windowSize))
+            capacity <<= 1;
+        slots.assign(capacity, InFlightFrame());
+        mask = capacity - 1;
+        head = tail = base;
+    }
+    int size() const { return int(tail - head); }
+    bool empty() const { return head == tail; }
+    long base() const { return head; } // Message index of the oldest in-flight frame (or of the next one to send).
+    // Used to add the frame of message 'index', which must follow the last in-flight frame.
+    InFlightFrame& push(long index, int seqNum, double sendTime)
+    {
+        if(index != tail || size_t(size()) > mask)
+            throw std::logic_error("Frame " + std::to_string(index) + " doesn't fit the in-flight window [" + std::to_string(head) + ", " + std::to_string(tail) + ")");
+        InFlightFrame& frame = slots[index & mask];
+        frame.retransmits = frame.index == index ? frame.retransmits + 1 : 0;
+        frame.index = index;
+        frame.seqNum = seqNum;
+        frame.sendTime = sendTime;
+        tail++;
+        return frame;
+    }
+    // Used to drop the n oldest frames once they are acknowledged.
+    void slide(int n = 1)
+    {
+        if(n > size())
+            throw std::logic_error("Sliding the in-flight window by " + std::to_string(n) + " frames, only " + std::to_string(size()) + " are in flight");
+        head += n;
+    }
+    // Used to drop every in-flight frame so the window is sent again from its base.
+    void clear() { tail = head; }
+    bool contains(long index) const { return index >= head && index < tail; }
+    const InFlightFrame& operator[](long index) const { return slots[index & mask]; }
+
+  private:
+    std::vector<InFlightFrame> slots;
+    size_t mask = 0;
+    long head = 0; // Message index of the oldest in-flight frame.
+    long tail = 0; // Message index right after the newest in-flight frame.
+};
+
+#endif /* WINDOW_H_ */
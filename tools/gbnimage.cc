@@ -0,0 +1,73 @@
+/*
+ * gbnimage.cc
+ *
+ *  Converts a text input file to the binary input format (src/frameimage.h).
+ *
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "frameimage.h"
+
+int main(int argc, char **argv)
+{
+    long mtu = 0;
+    bool badOption = false;
+    std::vector<const char *> files;
+    for(int i = 1; i < argc; i++){
+        if(std::strncmp(argv[i], "--mtu=", 6) == 0)
+            mtu = std::atol(argv[i] + 6);
+        else if(argv[i][0] != '-')
+            files.push_back(argv[i]);
+        else
+            badOption = true;
+    }
+    if(badOption || files.size() != 2 || (mtu != 0 && mtu < FRAME_OVERHEAD + 4)){
+        std::fprintf(stderr, "usage: %s [--mtu=bytes] <input.txt> <image>\n"
+                "  Splits the lines for the mtu of the run (0 or at least %d, default 0) and writes the frames ready to send.\n",
+                argv[0], FRAME_OVERHEAD + 4);
+        return 1;
+    }
+    std::ifstream filestream(files[0]);
+    if(!filestream){
+        std::fprintf(stderr, "Error opening file '%s'?\n", files[0]);
+        return 1;
+    }
+    // The same lines and fragments as the node reading the text file.
+    std::vector<std::string> errors, messages;
+    std::vector<bool> moreFragments;
+    size_t lines = 0;
+    std::string line;
+    while(getline(filestream, line)){
+        if(line.find('#') == 0)
+            continue; // ignore comment lines
+        if(line.size() < 5){
+            std::fprintf(stderr, "Bad line '%s' in '%s', use <4-bit error code> <message>\n", line.c_str(), files[0]);
+            return 1;
+        }
+        std::string err = line.substr(0,4);
+        std::string mes = line.substr(5);
+        size_t start = 0;
+        do {
+            size_t end = fragmentEnd(mes, start, mtu);
+            errors.push_back(start == 0 ? err : "0000");
+            messages.push_back(mes.substr(start, end - start));
+            moreFragments.push_back(end < mes.size());
+            start = end;
+        } while(start < mes.size());
+        lines++;
+    }
+    try {
+        FrameImage::write(files[1], errors, messages, moreFragments, mtu, lines);
+        FrameImage image(files[1]);
+        std::printf("%s: %zu lines in %zu frames, %zu bytes\n", files[1], lines, image.count(), image.size());
+    } catch(const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
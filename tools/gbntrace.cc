@@ -0,0 +1,349 @@
+/*
+ * gbntrace.cc
+ *
+ *  Indexes the trace (output.txt) of a run and answers queries on it from the index.
+ *
+ */
+#include <sys/stat.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// The kinds of trace lines the nodes write.
+enum Kind { ERROR, SENT, TIMEOUT, ACK, NACK, RETRANSMIT, OTHER, KINDS };
+static const char *kindNames[KINDS] = {"error", "sent", "timeout", "ack", "nack", "retransmit", "other"};
+
+/**
+ * What a query looks at in a trace line.
+ */
+struct TraceLine
+{
+    int kind = OTHER;
+    int node = -1;
+    double time = 0;
+    long seq = -1; // The seq_num of a sent frame, a timeout or a fast retransmit, the number of an ACK/NACK, -1 for an error code line.
+};
+
+// Reads the number in the brackets after 'key', false if the line has no such key.
+static bool bracketNumber(const std::string& line, const char *key, double& value)
+{
+    size_t at = line.find(key);
+    if(at == std::string::npos)
+        return false;
+    const char *begin = line.c_str() + at + std::strlen(key);
+    char *end;
+    value = std::strtod(begin, &end);
+    return end != begin;
+}
+
+static TraceLine parseLine(const std::string& line)
+{
+    TraceLine parsed;
+    double number;
+    if(line.compare(0, 9, "At time [") == 0){
+        if(line.find(", Introducing channel error") != std::string::npos)
+            parsed.kind = ERROR;
+        else if(line.find("] frame with seq_num=[") != std::string::npos){
+            parsed.kind = SENT;
+            if(bracketNumber(line, "seq_num=[", number))
+                parsed.seq = long(number);
+        } else if(line.find("Sending [NACK]") != std::string::npos || line.find("Sending [ACK]") != std::string::npos){
+            parsed.kind = line.find("Sending [NACK]") != std::string::npos ? NACK : ACK;
+            if(bracketNumber(line, "with number [", number))
+                parsed.seq = long(number);
+        }
+        bracketNumber(line, "At time [", parsed.time);
+    } else if(line.compare(0, 24, "Time out event at time [") == 0){
+        parsed.kind = TIMEOUT;
+        bracketNumber(line, "Time out event at time [", parsed.time);
+        if(bracketNumber(line, "seq_num=[", number))
+            parsed.seq = long(number);
+    } else if(line.compare(0, 31, "Fast retransmit event at time [") == 0){
+        parsed.kind = RETRANSMIT;
+        bracketNumber(line, "Fast retransmit event at time [", parsed.time);
+        if(bracketNumber(line, "seq_num=[", number))
+            parsed.seq = long(number);
+    }
+    if(bracketNumber(line, "Node[", number))
+        parsed.node = int(number);
+    return parsed;
+}
+
+/**
+ * The sidecar index (<trace>.idx): the trace cut into blocks of consecutive lines, and per block where it starts,
+ * its time range, which nodes, kinds and sequence numbers occur in it (as bitmaps, a bit per value modulo 64)
+ * and how many lines of every kind it has. A query reads only the blocks whose summary can match, and counts the
+ * lines of the blocks entirely inside a time range without reading them.
+ */
+struct IndexHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t blockLines;
+    uint32_t blockCount;
+    uint64_t traceSize; // Size and modification time of the trace indexed, to notice a stale index.
+    int64_t traceTime;
+};
+struct Block
+{
+    uint64_t offset;
+    uint64_t firstLine;
+    uint32_t lines;
+    uint32_t kinds;
+    double minTime;
+    double maxTime;
+    uint64_t nodes;
+    uint64_t seqs;
+    uint32_t counts[KINDS];
+};
+static const uint32_t indexVersion = 2; // 2 added the fast retransmit lines.
+
+static uint64_t bit(long value) { return uint64_t(1) << (value & 63); }
+
+static bool traceStatus(const std::string& trace, uint64_t& size, int64_t& time)
+{
+    struct stat status;
+    if(stat(trace.c_str(), &status) != 0)
+        return false;
+    size = status.st_size;
+    time = status.st_mtime;
+    return true;
+}
+
+static void buildIndex(const std::string& trace, uint32_t blockLines)
+{
+    IndexHeader header = {};
+    std::memcpy(header.magic, "GBTI", 4);
+    header.version = indexVersion;
+    header.blockLines = blockLines;
+    if(!traceStatus(trace, header.traceSize, header.traceTime))
+        throw std::runtime_error("Error opening file '" + trace + "'?");
+    std::ifstream filestream(trace, std::ios::binary);
+    if(!filestream)
+        throw std::runtime_error("Error opening file '" + trace + "'?");
+    std::vector<Block> blocks;
+    std::string line;
+    uint64_t offset = 0, lineNumber = 0;
+    while(getline(filestream, line)){
+        if(lineNumber % blockLines == 0){
+            Block block = {};
+            block.offset = offset;
+            block.firstLine = lineNumber;
+            block.minTime = 1e300;
+            block.maxTime = -1e300;
+            blocks.push_back(block);
+        }
+        Block& block = blocks.back();
+        TraceLine parsed = parseLine(line);
+        block.lines++;
+        block.kinds |= 1 << parsed.kind;
+        block.counts[parsed.kind]++;
+        if(parsed.kind != OTHER){
+            block.minTime = std::min(block.minTime, parsed.time);
+            block.maxTime = std::max(block.maxTime, parsed.time);
+        }
+        if(parsed.node >= 0)
+            block.nodes |= bit(parsed.node);
+        if(parsed.seq >= 0)
+            block.seqs |= bit(parsed.seq);
+        offset += line.size() + 1;
+        lineNumber++;
+    }
+    header.blockCount = blocks.size();
+    std::string indexFile = trace + ".idx";
+    std::ofstream out(indexFile, std::ios::binary | std::ios::trunc);
+    out.write((const char *)&header, sizeof(header));
+    out.write((const char *)blocks.data(), blocks.size() * sizeof(Block));
+    if(!out)
+        throw std::runtime_error("Error writing file '" + indexFile + "'?");
+    std::printf("%s: %" PRIu64 " lines in %zu blocks of %u\n", indexFile.c_str(), lineNumber, blocks.size(), blockLines);
+}
+
+// Loads the index of the trace, false if there is none or it's stale.
+static bool loadIndex(const std::string& trace, IndexHeader& header, std::vector<Block>& blocks)
+{
+    std::ifstream in(trace + ".idx", std::ios::binary);
+    uint64_t size;
+    int64_t time;
+    if(!in || !in.read((char *)&header, sizeof(header)) || std::memcmp(header.magic, "GBTI", 4) != 0 || header.version != indexVersion
+            || !traceStatus(trace, size, time) || size != header.traceSize || time != header.traceTime)
+        return false;
+    blocks.resize(header.blockCount);
+    return bool(in.read((char *)blocks.data(), blocks.size() * sizeof(Block)));
+}
+
+struct Query
+{
+    double from = -1e300, to = 1e300;
+    int node = -1;
+    int kind = -1;
+    long seq = -1;
+    bool count = false, last = false, lineNumbers = false;
+    long limit = -1;
+
+    bool mayMatch(const Block& block) const
+    {
+        if(block.maxTime < from || block.minTime > to)
+            return false;
+        if(kind >= 0 && !(block.kinds & (1 << kind)))
+            return false;
+        if(node >= 0 && !(block.nodes & bit(node)))
+            return false;
+        return seq < 0 || (block.seqs & bit(seq));
+    }
+    // Whether every line of the block of the wanted kind matches, so the block's count is the answer.
+    bool coversAll(const Block& block) const
+    {
+        return node < 0 && seq < 0 && block.minTime >= from && block.maxTime <= to && (kind >= 0 || block.counts[OTHER] == 0);
+    }
+    bool matches(const TraceLine& parsed) const
+    {
+        return (kind < 0 || parsed.kind == kind) && (node < 0 || parsed.node == node) && (seq < 0 || parsed.seq == seq)
+                && parsed.kind != OTHER && parsed.time >= from && parsed.time <= to;
+    }
+};
+
+// Reads the lines of a block and calls found(line number, line) for the matching ones, stops when it returns false.
+template<typename Found>
+static bool scanBlock(std::ifstream& filestream, const Block& block, const Query& query, Found found)
+{
+    filestream.clear();
+    filestream.seekg(block.offset);
+    std::string line;
+    for(uint32_t i = 0; i < block.lines && getline(filestream, line); i++)
+        if(query.matches(parseLine(line)) && !found(block.firstLine + i, line))
+            return false;
+    return true;
+}
+
+static int runQuery(const std::string& trace, const Query& query)
+{
+    IndexHeader header;
+    std::vector<Block> blocks;
+    if(!loadIndex(trace, header, blocks)){
+        buildIndex(trace, 4096);
+        if(!loadIndex(trace, header, blocks))
+            throw std::runtime_error("Can't read the index of '" + trace + "'");
+    }
+    std::ifstream filestream(trace, std::ios::binary);
+    if(!filestream)
+        throw std::runtime_error("Error opening file '" + trace + "'?");
+    auto print = [&](uint64_t lineNumber, const std::string& line) {
+        if(query.lineNumbers)
+            std::printf("%" PRIu64 ":", lineNumber + 1);
+        std::printf("%s\n", line.c_str());
+    };
+    if(query.count){
+        uint64_t total = 0;
+        for(const Block& block : blocks){
+            if(!query.mayMatch(block))
+                continue;
+            if(query.coversAll(block)){
+                if(query.kind >= 0)
+                    total += block.counts[query.kind];
+                else
+                    total += block.lines;
+            } else
+                scanBlock(filestream, block, query, [&](uint64_t, const std::string&) { total++; return true; });
+        }
+        std::printf("%" PRIu64 "\n", total);
+        return 0;
+    }
+    if(query.last){
+        // From the last block back, the first block with a match has the last one.
+        for(size_t b = blocks.size(); b-- > 0; ){
+            if(!query.mayMatch(blocks[b]))
+                continue;
+            std::string lastLine;
+            uint64_t lastNumber = 0;
+            bool found = false;
+            scanBlock(filestream, blocks[b], query, [&](uint64_t n, const std::string& line) { lastNumber = n; lastLine = line; found = true; return true; });
+            if(found){
+                print(lastNumber, lastLine);
+                return 0;
+            }
+        }
+        return 1;
+    }
+    long printed = 0;
+    for(const Block& block : blocks){
+        if(!query.mayMatch(block))
+            continue;
+        bool more = scanBlock(filestream, block, query, [&](uint64_t n, const std::string& line) {
+            print(n, line);
+            return query.limit < 0 || ++printed < query.limit;
+        });
+        if(!more)
+            break;
+    }
+    return 0;
+}
+
+static void usage(const char *program)
+{
+    std::fprintf(stderr,
+            "usage: %s index [--block-lines=N] <output.txt>\n"
+            "       %s query [filters] [--count | --last] [--limit=N] [-n] <output.txt>\n"
+            "  Filters: --from=T --to=T (simulation time), --node=N, --kind=error|sent|timeout|ack|nack|retransmit, --seq=S\n"
+            "  The index <output.txt>.idx is built on the first query and again whenever the trace changed.\n", program, program);
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 3){
+        usage(argv[0]);
+        return 1;
+    }
+    std::string command = argv[1];
+    std::string trace;
+    Query query;
+    uint32_t blockLines = 4096;
+    try {
+        for(int i = 2; i < argc; i++){
+            std::string arg = argv[i];
+            size_t eq = arg.find('=');
+            std::string name = arg.substr(0, eq), value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+            if(name == "--from") query.from = std::stod(value);
+            else if(name == "--to") query.to = std::stod(value);
+            else if(name == "--node") query.node = std::stoi(value);
+            else if(name == "--seq") query.seq = std::stol(value);
+            else if(name == "--count") query.count = true;
+            else if(name == "--last") query.last = true;
+            else if(name == "--limit") query.limit = std::stol(value);
+            else if(name == "-n") query.lineNumbers = true;
+            else if(name == "--block-lines") blockLines = std::stoul(value);
+            else if(name == "--kind"){
+                for(int k = 0; k < OTHER; k++)
+                    if(value == kindNames[k])
+                        query.kind = k;
+                if(query.kind < 0)
+                    throw std::invalid_argument(value);
+            }
+            else if(arg[0] != '-' && trace.empty()) trace = arg;
+            else throw std::invalid_argument(arg);
+        }
+    } catch(const std::logic_error&) {
+        usage(argv[0]);
+        return 1;
+    }
+    if(trace.empty() || blockLines == 0 || (command != "index" && command != "query")){
+        usage(argv[0]);
+        return 1;
+    }
+    try {
+        if(command == "index"){
+            buildIndex(trace, blockLines);
+            return 0;
+        }
+        return runQuery(trace, query);
+    } catch(const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,668 @@
+/*
+ * gbnudp.cc
+ *
+ *  The Go Back N core (src/gbn.h) run by real processes over UDP on localhost.
+ *
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "gbn.h"
+#include "checksum.h"
+
+#define flag '$'
+#define escape '/'
+// Bytes of the frame header on the wire: flow id (2), frame type, unused, sequence/ACK number (4) and the parity trailer.
+#define HEADER_SIZE 9
+#define MAX_FRAME 2048
+// Frames handed to the kernel per sendmmsg/recvmmsg call at most.
+#define BATCH 64
+
+enum FrameType { DATA = 0, ACK = 1, NACK = 2, END = 3 };
+
+/**
+ * The run's settings, the counterparts of the network parameters. Times are in seconds of wall-clock time.
+ */
+struct Options
+{
+    int basePort = 47000; // Node[i] listens on basePort + i.
+    int windowSize = 8; // WS
+    int seqNumBits = 0; // seqNumBits, 0 for the numbering modulo the window size.
+    double timeout = 0.2; // TO
+    double lossProbability = 0.1; // LP, used with errors.
+    double errorDelay = 0.05; // ED, used with errors.
+    double duplicateDelay = 0.01; // DD, used with errors.
+    bool errors = false; // Whether the 4-bit error codes of the input files and the ACK loss are applied, like nodeErrors.
+    bool fastRetransmit = false; // fastRetransmit
+    double idle = 5; // A node gives up after this long without a frame.
+    unsigned seed = 1;
+    int node = -1; // Run only this node, -1 to fork a process per node of the schedule.
+};
+
+/**
+ * One transfer of the schedule in coordinator.txt, as the Coordinator reads it.
+ */
+struct Session
+{
+    int src;
+    int dst;
+    double start;
+    std::string inputFile;
+};
+
+struct Frame
+{
+    int flowId = 0;
+    int type = DATA;
+    int num = 0; // Sequence number of a data frame, ACK number of a control frame, message count of an END.
+    unsigned char parity = 0;
+    std::string payload;
+};
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static sockaddr_in nodeAddress(const Options& options, int node)
+{
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(options.basePort + node);
+    return address;
+}
+
+// Reads the schedule: Session=[src,dst,start,file] or Node_id=[src,start] lines, as the Coordinator does.
+static std::vector<Session> readCoordinatorFile(const char *filename)
+{
+    std::ifstream filestream(filename);
+    if(!filestream)
+        throw std::runtime_error(std::string("Error opening file '") + filename + "'?");
+    std::vector<Session> sessions;
+    std::string line;
+    while(getline(filestream, line)){
+        size_t beg = line.find('[');
+        size_t end = line.find(']');
+        if(beg == std::string::npos || end == std::string::npos || end < beg)
+            continue;
+        std::vector<std::string> fields;
+        std::stringstream entries(line.substr(beg+1, end-beg-1));
+        std::string field;
+        while(getline(entries, field, ','))
+            fields.push_back(field);
+        Session session;
+        try {
+            if(line.compare(0, beg, "Node_id=") == 0 && fields.size() == 2) {
+                session.src = std::stoi(fields[0]);
+                session.dst = session.src == 0 ? 1 : 0;
+                session.start = std::stod(fields[1]);
+                session.inputFile = "input"+fields[0]+".txt";
+            } else if(line.compare(0, beg, "Session=") == 0 && fields.size() == 4) {
+                session.src = std::stoi(fields[0]);
+                session.dst = std::stoi(fields[1]);
+                session.start = std::stod(fields[2]);
+                session.inputFile = fields[3];
+            } else
+                throw std::invalid_argument(line);
+        } catch(const std::logic_error&) {
+            throw std::runtime_error("Bad line '" + line + "' in '" + filename + "', use Session=[src,dst,start,file] or Node_id=[src,start]");
+        }
+        if(session.src < 0 || session.dst < 0 || session.src == session.dst || session.start < 0)
+            throw std::runtime_error("Bad session line '" + line + "' in '" + filename + "'");
+        sessions.push_back(session);
+    }
+    if(sessions.empty())
+        throw std::runtime_error(std::string("No session in '") + filename + "'");
+    return sessions;
+}
+
+/**
+ * A UDP socket that hands the frames to the kernel in batches: the frames queued while handling an event go out
+ * with one sendmmsg, and the frames waiting on the socket are taken with one recvmmsg.
+ */
+class BatchSocket
+{
+  public:
+    int fd = -1;
+    long sendCalls = 0, recvCalls = 0, framesSent = 0, framesReceived = 0, bytesSent = 0, bytesReceived = 0;
+
+    void open(const sockaddr_in& address)
+    {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if(fd < 0 || bind(fd, (const sockaddr *)&address, sizeof(address)) < 0)
+            throw std::runtime_error("Can't bind UDP port " + std::to_string(ntohs(address.sin_port)) + ": " + std::strerror(errno));
+        int size = 4 << 20;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    }
+    void queue(const Frame& frame, const sockaddr_in& to)
+    {
+        if(queued == BATCH)
+            flush();
+        if(HEADER_SIZE + frame.payload.size() > MAX_FRAME)
+            throw std::runtime_error("A frame of " + std::to_string(frame.payload.size()) + " bytes doesn't fit a datagram of " + std::to_string(MAX_FRAME));
+        unsigned char *buffer = outBuffers[queued];
+        buffer[0] = frame.flowId >> 8;
+        buffer[1] = frame.flowId;
+        buffer[2] = frame.type;
+        buffer[3] = 0;
+        uint32_t num = htonl(frame.num);
+        std::memcpy(buffer + 4, &num, 4);
+        buffer[8] = frame.parity;
+        std::memcpy(buffer + HEADER_SIZE, frame.payload.data(), frame.payload.size());
+        outAddresses[queued] = to;
+        outVectors[queued] = {buffer, HEADER_SIZE + frame.payload.size()};
+        std::memset(&outMessages[queued], 0, sizeof(mmsghdr));
+        outMessages[queued].msg_hdr.msg_name = &outAddresses[queued];
+        outMessages[queued].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        outMessages[queued].msg_hdr.msg_iov = &outVectors[queued];
+        outMessages[queued].msg_hdr.msg_iovlen = 1;
+        queued++;
+    }
+    void flush()
+    {
+        for(int sent = 0; sent < queued; ){
+            int n = sendmmsg(fd, outMessages + sent, queued - sent, 0);
+            sendCalls++;
+            if(n < 0){
+                if(errno == EINTR || errno == EAGAIN || errno == ENOBUFS)
+                    continue;
+                throw std::runtime_error(std::string("sendmmsg failed: ") + std::strerror(errno));
+            }
+            for(int i = sent; i < sent + n; i++)
+                bytesSent += outMessages[i].msg_len;
+            sent += n;
+            framesSent += n;
+        }
+        queued = 0;
+    }
+    // Takes the frames waiting on the socket without blocking, returns how many there were.
+    int receive(std::vector<Frame>& frames, std::vector<sockaddr_in>& from)
+    {
+        for(int i = 0; i < BATCH; i++){
+            inVectors[i] = {inBuffers[i], MAX_FRAME};
+            std::memset(&inMessages[i], 0, sizeof(mmsghdr));
+            inMessages[i].msg_hdr.msg_name = &inAddresses[i];
+            inMessages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            inMessages[i].msg_hdr.msg_iov = &inVectors[i];
+            inMessages[i].msg_hdr.msg_iovlen = 1;
+        }
+        int n = recvmmsg(fd, inMessages, BATCH, MSG_DONTWAIT, nullptr);
+        recvCalls++;
+        if(n < 0){
+            if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                return 0;
+            throw std::runtime_error(std::string("recvmmsg failed: ") + std::strerror(errno));
+        }
+        frames.clear();
+        from.clear();
+        for(int i = 0; i < n; i++){
+            size_t length = inMessages[i].msg_len;
+            if(length < HEADER_SIZE)
+                continue; // Not one of ours.
+            const unsigned char *buffer = inBuffers[i];
+            Frame frame;
+            frame.flowId = buffer[0] << 8 | buffer[1];
+            frame.type = buffer[2];
+            uint32_t num;
+            std::memcpy(&num, buffer + 4, 4);
+            frame.num = ntohl(num);
+            frame.parity = buffer[8];
+            frame.payload.assign((const char *)buffer + HEADER_SIZE, length - HEADER_SIZE);
+            frames.push_back(frame);
+            from.push_back(inAddresses[i]);
+            bytesReceived += length;
+        }
+        framesReceived += n;
+        return n;
+    }
+
+  private:
+    int queued = 0;
+    unsigned char outBuffers[BATCH][MAX_FRAME];
+    sockaddr_in outAddresses[BATCH];
+    iovec outVectors[BATCH];
+    mmsghdr outMessages[BATCH];
+    unsigned char inBuffers[BATCH][MAX_FRAME];
+    sockaddr_in inAddresses[BATCH];
+    iovec inVectors[BATCH];
+    mmsghdr inMessages[BATCH];
+};
+
+/**
+ * One node of the schedule as a process: the sender of the sessions it starts and the receiver of the ones sent to it,
+ * all on one socket. Like the Node's adapter it gives the core a transport, here the batched socket, and a random source.
+ * The timers are a queue of deadlines per flow; they expire in the order they were started, so the core's stopped-timer
+ * count works as in the simulation.
+ */
+class UdpNode : public GbnTransport, public GbnRandom
+{
+  public:
+    UdpNode(int id, const std::vector<Session>& sessions, const Options& options, double epoch)
+        : id(id), options(options), epoch(epoch), rng(options.seed + id)
+    {
+        SeqSpace seqSpace(options.seqNumBits, options.windowSize);
+        for(size_t i = 0; i < sessions.size(); i++){
+            const Session& s = sessions[i];
+            if(s.src == id){
+                SenderFlow& flow = senders[i];
+                flow.peer = nodeAddress(options, s.dst);
+                flow.start = epoch + s.start;
+                flow.inputFile = s.inputFile;
+                readInputFile(s.inputFile.c_str(), flow);
+                flow.tx.reset(seqSpace, reAckWindowSize(seqSpace, options.windowSize), flow.messages.size());
+            } else if(s.dst == id){
+                ReceiverFlow& flow = receivers[i];
+                flow.start = epoch + s.start;
+                // A datagram can be lost for real, the receiver answers the frames it discards too.
+                flow.rx.reset(seqSpace, options.errors ? options.lossProbability : -1, true);
+            }
+        }
+    }
+    BatchSocket socket;
+    void run();
+    void report();
+
+    virtual double sendData(long index, int seqNum, int) override;
+    virtual void sendControl(int ackNum, bool nack, bool lost) override;
+    virtual double uniform(double a, double b) override { return std::uniform_real_distribution<double>(a, b)(rng); }
+
+  protected:
+    struct SenderFlow
+    {
+        sockaddr_in peer;
+        double start = 0;
+        std::string inputFile;
+        GbnSender<SeqSpace> tx;
+        std::vector<std::string> errors, messages;
+        long messageBytes = 0;
+        std::deque<double> timers; // Deadlines of the running timers, oldest first.
+        bool noErrors = false; // Used to send the first frame after a timeout error free.
+        bool started = false, ended = false;
+        long frames = 0, timeouts = 0;
+        double endTime = 0;
+    };
+    struct ReceiverFlow
+    {
+        double start = 0;
+        GbnReceiver<SeqSpace> rx;
+        long deliveredBytes = 0;
+        double lastDelivery = 0;
+        bool ended = false;
+    };
+    struct DelayedFrame
+    {
+        Frame frame;
+        sockaddr_in to;
+    };
+    int id;
+    Options options;
+    double epoch; // The time the schedule starts from.
+    std::mt19937 rng;
+    std::map<int, SenderFlow> senders; // By flow id, the session index.
+    std::map<int, ReceiverFlow> receivers;
+    std::multimap<double, DelayedFrame> delayed; // Frames held back by the delay error, by the time they go out.
+    int currentFlow = -1; // The flow the core is working on.
+    sockaddr_in replyTo; // Where the answers of the receiver go.
+
+    void readInputFile(const char *filename, SenderFlow& flow);
+    std::string byteStuffing(const std::string& message);
+    void send(const Frame& frame, const sockaddr_in& to, double at);
+    void fill(int flowId);
+    void handleFrame(const Frame& frame, const sockaddr_in& from);
+    bool finished() const;
+};
+
+void UdpNode::run()
+{
+    std::vector<Frame> frames;
+    std::vector<sockaddr_in> from;
+    double lastActivity = now();
+    while(!finished()){
+        double t = now();
+        // Start the sessions whose time has come.
+        for(auto& f : senders){
+            if(!f.second.started && f.second.start <= t){
+                f.second.started = true;
+                fill(f.first);
+            }
+        }
+        // Send the delayed frames that are due.
+        while(!delayed.empty() && delayed.begin()->first <= t){
+            socket.queue(delayed.begin()->second.frame, delayed.begin()->second.to);
+            delayed.erase(delayed.begin());
+        }
+        // Expire the timers.
+        for(auto& f : senders){
+            SenderFlow& flow = f.second;
+            while(!flow.ended && !flow.timers.empty() && flow.timers.front() <= t){
+                flow.timers.pop_front();
+                if(flow.tx.timerFired()){
+                    flow.timeouts++;
+                    flow.noErrors = true;
+                    fill(f.first);
+                }
+            }
+        }
+        socket.flush();
+        // Wait for a frame or the next deadline.
+        double next = t + options.idle;
+        for(auto& f : senders){
+            const SenderFlow& flow = f.second;
+            if(!flow.started)
+                next = std::min(next, flow.start);
+            else if(!flow.ended && !flow.timers.empty())
+                next = std::min(next, flow.timers.front());
+        }
+        if(!delayed.empty())
+            next = std::min(next, delayed.begin()->first);
+        pollfd pfd = {socket.fd, POLLIN, 0};
+        int wait = next > t ? int((next - t) * 1000) + 1 : 0;
+        if(poll(&pfd, 1, wait) > 0){
+            while(socket.receive(frames, from) > 0){
+                for(size_t i = 0; i < frames.size(); i++)
+                    handleFrame(frames[i], from[i]);
+                socket.flush();
+            }
+            lastActivity = now();
+        } else if(now() - lastActivity > options.idle){
+            std::fprintf(stderr, "Node[%d] got no frame for %g s, giving up\n", id, options.idle);
+            break;
+        }
+    }
+    socket.flush();
+}
+
+void UdpNode::handleFrame(const Frame& frame, const sockaddr_in& from)
+{
+    if(frame.type == DATA || frame.type == END){
+        auto f = receivers.find(frame.flowId);
+        if(f == receivers.end())
+            return;
+        ReceiverFlow& flow = f->second;
+        if(frame.type == END){
+            flow.ended = true;
+            return;
+        }
+        currentFlow = frame.flowId;
+        replyTo = from;
+        // Only the awaited frame is checked, the core answers the others with the same ACK whatever they carry.
+        bool intact = frame.num != flow.rx.expected || ParityChecksum::compute(frame.payload) == frame.parity;
+        if(flow.rx.dataReceived(frame.num, intact, *this, *this)){
+            // The original message is the payload without the flags and the escape characters of the byte stuffing.
+            for(size_t i = 1; i + 1 < frame.payload.size(); i++){
+                if(frame.payload[i] == escape)
+                    i++;
+                flow.deliveredBytes++;
+            }
+            flow.lastDelivery = now();
+        }
+        return;
+    }
+    auto f = senders.find(frame.flowId);
+    if(f == senders.end() || f->second.ended)
+        return;
+    SenderFlow& flow = f->second;
+    if(frame.type == ACK && flow.tx.ackReceived(frame.num))
+        fill(frame.flowId);
+    else if(frame.type == NACK && options.fastRetransmit && flow.tx.nackReceived(frame.num)){
+        flow.noErrors = true;
+        fill(frame.flowId);
+    }
+}
+
+// Used to send what the window of a flow allows, and to end the flow once everything was acknowledged.
+void UdpNode::fill(int flowId)
+{
+    SenderFlow& flow = senders[flowId];
+    currentFlow = flowId;
+    flow.tx.fillWindow(*this);
+    if(flow.tx.done()){
+        // The receiver learns the session is over; repeated as the datagrams aren't acknowledged.
+        Frame end;
+        end.flowId = flowId;
+        end.type = END;
+        end.num = flow.messages.size();
+        for(int i = 0; i < 3; i++)
+            socket.queue(end, flow.peer);
+        flow.ended = true;
+        flow.endTime = now();
+    }
+}
+
+double UdpNode::sendData(long j, int seqNum, int)
+{
+    SenderFlow& flow = senders[currentFlow];
+    std::string value = byteStuffing(flow.messages[j]);
+    bool modificationE = false, lossE = false, duplicationE = false, delayE = false;
+    // In case of timeout, send the first message in the window error free while the other messages with their errors.
+    if(!flow.noErrors && options.errors){
+        modificationE = flow.errors[j][0] == '1';
+        lossE = flow.errors[j][1] == '1';
+        duplicationE = flow.errors[j][2] == '1';
+        delayE = flow.errors[j][3] == '1';
+    }
+    else
+        flow.errors[j] = "0000";
+    flow.noErrors = false;
+    Frame frame;
+    frame.flowId = currentFlow;
+    frame.type = DATA;
+    frame.num = seqNum;
+    frame.parity = ParityChecksum::compute(value);
+    frame.payload = value;
+    double t = now();
+    if(!lossE){
+        if(modificationE){
+            int randomI = int(uniform(0, frame.payload.size()));
+            int randomBit = int(uniform(0, 8));
+            frame.payload[randomI] ^= 1 << randomBit;
+        }
+        double at = delayE ? t + options.errorDelay : t;
+        send(frame, flow.peer, at);
+        if(duplicationE)
+            send(frame, flow.peer, at + options.duplicateDelay);
+    }
+    flow.frames++;
+    flow.timers.push_back(t + options.timeout);
+    return t;
+}
+
+void UdpNode::sendControl(int ackNum, bool nack, bool lost)
+{
+    if(lost)
+        return;
+    Frame frame;
+    frame.flowId = currentFlow;
+    frame.type = nack ? NACK : ACK;
+    frame.num = ackNum;
+    socket.queue(frame, replyTo);
+}
+
+void UdpNode::send(const Frame& frame, const sockaddr_in& to, double at)
+{
+    if(at <= now())
+        socket.queue(frame, to);
+    else
+        delayed.insert({at, DelayedFrame{frame, to}});
+}
+
+bool UdpNode::finished() const
+{
+    for(auto& f : senders)
+        if(!f.second.ended)
+            return false;
+    for(auto& f : receivers)
+        if(!f.second.ended)
+            return false;
+    return true;
+}
+
+void UdpNode::report()
+{
+    for(auto& f : senders){
+        const SenderFlow& flow = f.second;
+        double elapsed = (flow.ended ? flow.endTime : now()) - flow.start;
+        std::printf("Node[%d] flow %d %s: %zu messages in %ld frames (%ld timeouts), %.6f s, %.6g bit/s\n", id, f.first,
+                flow.ended ? "sent" : "NOT FINISHED", flow.messages.size(), flow.frames, flow.timeouts, elapsed,
+                8 * flow.messageBytes / elapsed);
+    }
+    for(auto& f : receivers){
+        const ReceiverFlow& flow = f.second;
+        double elapsed = flow.lastDelivery - flow.start;
+        std::printf("Node[%d] flow %d %s: %ld bytes delivered, goodput %.6g bit/s\n", id, f.first,
+                flow.ended ? "received" : "NOT FINISHED", flow.deliveredBytes, elapsed > 0 ? 8 * flow.deliveredBytes / elapsed : 0.0);
+    }
+    std::printf("Node[%d] %ld frames (%ld bytes) in %ld sendmmsg calls, %.2f per call; %ld frames (%ld bytes) in %ld recvmmsg calls, %.2f per call\n",
+            id, socket.framesSent, socket.bytesSent, socket.sendCalls, socket.sendCalls ? double(socket.framesSent) / socket.sendCalls : 0.0,
+            socket.framesReceived, socket.bytesReceived, socket.recvCalls, socket.recvCalls ? double(socket.framesReceived) / socket.recvCalls : 0.0);
+    std::fflush(stdout);
+}
+
+void UdpNode::readInputFile(const char *filename, SenderFlow& flow)
+{
+    std::ifstream filestream(filename);
+    if(!filestream)
+        throw std::runtime_error(std::string("Error opening file '") + filename + "'?");
+    std::string line;
+    while(getline(filestream, line)){
+        if(line.find('#') == 0)
+            continue; // ignore comment lines
+        if(line.size() < 5)
+            throw std::runtime_error("Bad line '" + line + "' in '" + filename + "'");
+        flow.errors.push_back(line.substr(0, 4));
+        flow.messages.push_back(line.substr(5));
+        flow.messageBytes += flow.messages.back().size();
+    }
+}
+
+std::string UdpNode::byteStuffing(const std::string& message)
+{
+    std::string s = "$";
+    for(char c : message){
+        if(c == flag || c == escape)
+            s += escape;
+        s += c;
+    }
+    s += flag;
+    return s;
+}
+
+static void usage(const char *program)
+{
+    std::fprintf(stderr,
+            "usage: %s [options] <coordinator.txt>\n"
+            "  --node=N            run only Node[N] (default: a process per node of the schedule)\n"
+            "  --port=P            Node[i] listens on UDP port P+i (default 47000)\n"
+            "  --ws=N --seq-bits=N window size and sequence-number width (default 8, 0)\n"
+            "  --to=S              timeout in seconds (default 0.2)\n"
+            "  --errors            apply the error codes of the input files and the ACK loss\n"
+            "  --lp=P --ed=S --dd=S ACK loss probability, error delay and duplicate delay (default 0.1, 0.05, 0.01)\n"
+            "  --fast-retransmit   go back on a NACK without waiting for the timeout\n"
+            "  --idle=S            give up after S seconds without a frame (default 5)\n"
+            "  --seed=N            seed of the random errors (default 1)\n", program);
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    const char *coordinatorFile = nullptr;
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string name = arg.substr(0, eq), value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        try {
+            if(name == "--node") options.node = std::stoi(value);
+            else if(name == "--port") options.basePort = std::stoi(value);
+            else if(name == "--ws") options.windowSize = std::stoi(value);
+            else if(name == "--seq-bits") options.seqNumBits = std::stoi(value);
+            else if(name == "--to") options.timeout = std::stod(value);
+            else if(name == "--errors") options.errors = true;
+            else if(name == "--lp") options.lossProbability = std::stod(value);
+            else if(name == "--ed") options.errorDelay = std::stod(value);
+            else if(name == "--dd") options.duplicateDelay = std::stod(value);
+            else if(name == "--fast-retransmit") options.fastRetransmit = true;
+            else if(name == "--idle") options.idle = std::stod(value);
+            else if(name == "--seed") options.seed = std::stoul(value);
+            else if(arg[0] != '-' && !coordinatorFile) coordinatorFile = argv[i];
+            else throw std::invalid_argument(arg);
+        } catch(const std::logic_error&) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(!coordinatorFile){
+        usage(argv[0]);
+        return 1;
+    }
+    try {
+        std::vector<Session> sessions = readCoordinatorFile(coordinatorFile);
+        std::set<int> nodes;
+        for(const Session& s : sessions){
+            nodes.insert(s.src);
+            nodes.insert(s.dst);
+        }
+        double epoch = now();
+        if(options.node >= 0){
+            UdpNode node(options.node, sessions, options, epoch);
+            node.socket.open(nodeAddress(options, options.node));
+            node.run();
+            node.report();
+            return 0;
+        }
+        // Every node gets its socket before any process starts, so no frame goes to a port nobody listens on yet.
+        std::map<int, BatchSocket *> sockets;
+        for(int n : nodes){
+            sockets[n] = new BatchSocket;
+            sockets[n]->open(nodeAddress(options, n));
+        }
+        std::vector<pid_t> children;
+        for(int n : nodes){
+            pid_t pid = fork();
+            if(pid < 0)
+                throw std::runtime_error(std::string("fork failed: ") + std::strerror(errno));
+            if(pid == 0){
+                try {
+                    UdpNode node(n, sessions, options, epoch);
+                    node.socket.fd = sockets[n]->fd;
+                    node.run();
+                    node.report();
+                } catch(const std::exception& e) {
+                    std::fprintf(stderr, "Node[%d]: %s\n", n, e.what());
+                    _exit(1);
+                }
+                _exit(0);
+            }
+            children.push_back(pid);
+        }
+        int failed = 0;
+        for(pid_t pid : children){
+            int status = 0;
+            waitpid(pid, &status, 0);
+            failed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+        }
+        return failed ? 1 : 0;
+    } catch(const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}